@@ -0,0 +1,206 @@
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+	#include <malloc.h>
+#endif
+
+#include <opencv2/core/core.hpp>
+
+static std::atomic<long long> heapAllocations(0);
+static std::atomic<long long> matAllocations(0);
+
+//Counts cv::Mat buffer allocations and otherwise defers to OpenCV's standard allocator.
+//The UMatData it returns belongs to the standard allocator, so releasing buffers goes straight there.
+class CountingMatAllocator : public cv::MatAllocator
+{
+public:
+	cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, int flags, cv::UMatUsageFlags usageFlags) const override
+	{
+		matAllocations.fetch_add(1, std::memory_order_relaxed);
+		return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+	}
+
+	bool allocate(cv::UMatData* data, int accessFlags, cv::UMatUsageFlags usageFlags) const override
+	{
+		return cv::Mat::getStdAllocator()->allocate(data, accessFlags, usageFlags);
+	}
+
+	void deallocate(cv::UMatData* data) const override
+	{
+		cv::Mat::getStdAllocator()->deallocate(data);
+	}
+};
+
+void InstallMatAllocationCounter()
+{
+	static CountingMatAllocator countingAllocator;
+	cv::Mat::setDefaultAllocator(&countingAllocator);
+}
+
+AllocationCounts GetAllocationCounts()
+{
+	AllocationCounts counts;
+	counts.heap = heapAllocations.load(std::memory_order_relaxed);
+	counts.mat = matAllocations.load(std::memory_order_relaxed);
+	return counts;
+}
+
+bool IsCountingHeapAllocations()
+{
+#ifdef COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+//Every form of new and delete is replaced together so memory from one of ours is never handed to the library's own
+
+void* operator new(std::size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+#ifdef __cpp_aligned_new
+
+static void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+
+	size = size == 0 ? 1 : size;
+	std::size_t bytes = std::max(sizeof(void*), (std::size_t)alignment);
+#ifdef _WIN32
+	return _aligned_malloc(size, bytes);
+#else
+	void* memory = nullptr;
+	return posix_memalign(&memory, bytes, size) == 0 ? memory : nullptr;
+#endif
+}
+
+static void FreeAligned(void* memory)
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* memory = AllocateAligned(size, alignment);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(memory);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+//Debug counters used to confirm the steady-state frame loop doesn't touch the heap.
+//Heap allocations are counted through a replacement global operator new, which only sees allocations made by our
+//own code (and statically linked libraries). Replacing it costs every allocation in the process an atomic add,
+//so it is only compiled in when COUNT_ALLOCATIONS is defined (cmake -DCOUNT_ALLOCATIONS=ON).
+//cv::Mat buffers are counted separately through the default MatAllocator, which also catches allocations made
+//inside the OpenCV DLL, and only once InstallMatAllocationCounter has been called.
+struct AllocationCounts
+{
+	long long heap;
+	long long mat;
+
+	AllocationCounts()
+	{
+		heap = 0;
+		mat = 0;
+	}
+};
+
+//Routes cv::Mat allocations through the counter. Call before any Mats are created.
+void InstallMatAllocationCounter();
+
+//Whether this build counts heap allocations at all
+bool IsCountingHeapAllocations();
+
+AllocationCounts GetAllocationCounts();
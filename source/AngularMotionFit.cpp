@@ -0,0 +1,152 @@
+#include "AngularMotionFit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PolarTable.h"
+
+//Starting uncertainty of the angle (degrees), velocity (degrees/s) and acceleration (degrees/s^2),
+//wide enough that the first few sightings decide everything
+const static double INITIAL_ANGLE_VARIANCE = 1e2;
+const static double INITIAL_VELOCITY_VARIANCE = 1e6;
+const static double INITIAL_ACCELERATION_VARIANCE = 1e6;
+//Sightings are never better than about half a degree, whatever the residuals say
+const static double MIN_NOISE_VARIANCE = 0.25;
+
+AngularMotionFit::AngularMotionFit(double forgetting, double maxGap)
+{
+	this->forgetting = forgetting;
+	this->maxGap = maxGap;
+	Clear();
+}
+
+void AngularMotionFit::Clear()
+{
+	count = 0;
+	noiseVariance = MIN_NOISE_VARIANCE;
+	for (int row = 0; row < 3; row++)
+	{
+		state[row] = 0;
+		for (int column = 0; column < 3; column++)
+		{
+			covariance[row][column] = 0;
+		}
+	}
+}
+
+void AngularMotionFit::Add(float angle, Timestamp time)
+{
+	double elapsed = std::chrono::duration<double>(time - lastTime).count();
+	if (count > 0 && (elapsed <= 0 || elapsed > maxGap))
+	{
+		Clear();
+	}
+
+	if (count == 0)
+	{
+		state[0] = angle;
+		covariance[0][0] = INITIAL_ANGLE_VARIANCE;
+		covariance[1][1] = INITIAL_VELOCITY_VARIANCE;
+		covariance[2][2] = INITIAL_ACCELERATION_VARIANCE;
+		lastTime = time;
+		count = 1;
+		return;
+	}
+
+	//Move the fit's origin to this sighting, carrying the uncertainty along with it (state = S state, covariance = S covariance S^T)
+	const double shift[3][3] = { { 1, elapsed, elapsed * elapsed / 2 }, { 0, 1, elapsed }, { 0, 0, 1 } };
+	double shiftedState[3];
+	double partial[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		shiftedState[row] = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			shiftedState[row] += shift[row][k] * state[k];
+		}
+		for (int column = 0; column < 3; column++)
+		{
+			partial[row][column] = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				partial[row][column] += shift[row][k] * covariance[k][column];
+			}
+		}
+	}
+	for (int row = 0; row < 3; row++)
+	{
+		state[row] = shiftedState[row];
+		for (int column = 0; column < 3; column++)
+		{
+			covariance[row][column] = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				covariance[row][column] += partial[row][k] * shift[column][k];
+			}
+		}
+	}
+	lastTime = time;
+	count++;
+
+	//Unwrap against where the fit expects it, which is right as long as it hasn't moved half a turn further than that
+	double predicted = state[0];
+	double predictedWrapped = std::fmod(predicted, 360.0);
+	if (predictedWrapped < 0)
+	{
+		predictedWrapped += 360.0;
+	}
+	double measured = predicted + GetAngleDifference((float)predictedWrapped, angle);
+
+	//The sighting is at the origin, so it only observes the angle directly.
+	//The gain spreads the error to velocity and acceleration through their covariance with it.
+	double error = measured - state[0];
+	double denominator = forgetting + covariance[0][0];
+
+	//The error is expected to be the sighting noise spread by denominator / forgetting. Until there are more
+	//sightings than unknowns the fit passes through all of them, so the errors say nothing about the noise.
+	if (count > 3)
+	{
+		double noiseSample = error * error * forgetting / denominator;
+		noiseVariance = std::max(MIN_NOISE_VARIANCE, forgetting * noiseVariance + (1 - forgetting) * noiseSample);
+	}
+	double gain[3];
+	double observed[3];
+	for (int row = 0; row < 3; row++)
+	{
+		gain[row] = covariance[row][0] / denominator;
+		observed[row] = covariance[0][row];
+	}
+
+	for (int row = 0; row < 3; row++)
+	{
+		state[row] += gain[row] * error;
+		for (int column = 0; column < 3; column++)
+		{
+			covariance[row][column] = (covariance[row][column] - gain[row] * observed[column]) / forgetting;
+		}
+	}
+}
+
+float AngularMotionFit::PredictAngle(Timestamp time) const
+{
+	double elapsed = std::chrono::duration<double>(time - lastTime).count();
+	double angle = std::fmod(state[0] + state[1] * elapsed + state[2] * elapsed * elapsed / 2, 360.0);
+	return (float)(angle < 0 ? angle + 360.0 : angle);
+}
+
+double AngularMotionFit::PredictAngularVelocity(Timestamp time) const
+{
+	double elapsed = std::chrono::duration<double>(time - lastTime).count();
+	return state[1] + state[2] * elapsed;
+}
+
+void AngularMotionFit::GetCovariance(double scaledCovariance[3][3]) const
+{
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			scaledCovariance[row][column] = covariance[row][column] * noiseVariance;
+		}
+	}
+}
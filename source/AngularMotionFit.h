@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Clock.h"
+
+//Angle against time of something going round the wheel, fitted as angle + velocity t + acceleration t^2 / 2 by
+//recursive least squares, so adding a sighting is O(1). Older sightings fade out by the forgetting factor,
+//which makes the fit a sliding window over the last few sightings that follows the ball as it slows down.
+//Angles are unwrapped as they arrive, so the fit carries on across 360 degrees and across laps.
+class AngularMotionFit
+{
+public:
+	//forgetting is the weight kept by the existing sightings each time a new one arrives.
+	//A gap of more than maxGap seconds between sightings starts the fit again.
+	AngularMotionFit(double forgetting, double maxGap);
+
+	void Clear();
+
+	//angle in degrees, as ToPolar gives it
+	void Add(float angle, Timestamp time);
+
+	//Number of sightings since the fit last started
+	int GetCount() const { return count; }
+
+	//Velocity and acceleration need at least three sightings to mean anything
+	bool IsValid() const { return count >= 3; }
+
+	//Degrees per second at the latest sighting, positive in the direction ToPolar's angle increases
+	double GetAngularVelocity() const { return state[1]; }
+
+	//Degrees per second per second
+	double GetAngularAcceleration() const { return state[2]; }
+
+	//How fast it is slowing down in degrees per second per second, whichever way it goes round
+	double GetDeceleration() const { return state[1] < 0 ? state[2] : -state[2]; }
+
+	//Angle in [0, 360) the fit puts it at at time
+	float PredictAngle(Timestamp time) const;
+
+	//Degrees per second the fit has it going at at time
+	double PredictAngularVelocity(Timestamp time) const;
+
+	//Time of the latest sighting, which the state and its covariance refer to
+	Timestamp GetLastTime() const { return lastTime; }
+
+	//Unwrapped angle, velocity and acceleration at the latest sighting
+	const double* GetState() const { return state; }
+
+	//Covariance of GetState, from the fit's own covariance scaled by the noise of the sightings it has seen
+	void GetCovariance(double scaledCovariance[3][3]) const;
+
+	//Variance of a sighting around the fit in degrees squared
+	double GetNoiseVariance() const { return noiseVariance; }
+
+private:
+	double forgetting;
+	double maxGap;
+	int count;
+
+	Timestamp lastTime;
+	//(unwrapped angle, velocity, acceleration) at lastTime, kept relative to the latest sighting so the
+	//regression never has to deal with large times
+	double state[3];
+	double covariance[3][3];
+	//running estimate of the sightings' variance around the fit
+	double noiseVariance;
+};
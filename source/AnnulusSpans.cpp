@@ -0,0 +1,74 @@
+#include "AnnulusSpans.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+AnnulusSpans::AnnulusSpans()
+	: center(-1, -1)
+{
+	innerRadius = -1;
+	outerRadius = 0;
+	version = 0;
+}
+
+bool AnnulusSpans::Prepare(cv::Size size, cv::Point center, int innerRadius, int outerRadius)
+{
+	if (size == this->size && center == this->center && innerRadius == this->innerRadius && outerRadius == this->outerRadius && !rowStarts.empty())
+	{
+		return false;
+	}
+
+	this->size = size;
+	this->center = center;
+	this->innerRadius = innerRadius;
+	this->outerRadius = outerRadius;
+	version++;
+
+	//Same drawing calls as masking the image directly, so both give the same pixels
+	mask.create(size, CV_8UC1);
+	if (outerRadius > 0)
+	{
+		mask.setTo(cv::Scalar(0));
+		cv::circle(mask, center, outerRadius, cv::Scalar(255), -1);
+	}
+	else
+	{
+		mask.setTo(cv::Scalar(255));
+	}
+	if (innerRadius >= 0)
+	{
+		cv::circle(mask, center, innerRadius, cv::Scalar(0), -1);
+	}
+
+	spans.clear();
+	rowStarts.resize(size.height + 1);
+	for (int y = 0; y < size.height; y++)
+	{
+		rowStarts[y] = (int)spans.size();
+
+		const uchar* row = mask.ptr<uchar>(y);
+		int x = 0;
+		while (x < size.width)
+		{
+			while (x < size.width && row[x] == 0)
+			{
+				x++;
+			}
+			if (x == size.width)
+			{
+				break;
+			}
+
+			Span span;
+			span.begin = x;
+			while (x < size.width && row[x] != 0)
+			{
+				x++;
+			}
+			span.end = x;
+			spans.push_back(span);
+		}
+	}
+	rowStarts[size.height] = (int)spans.size();
+
+	return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+//Horizontal run of pixels, end is one past the last pixel
+struct Span
+{
+	int begin;
+	int end;
+};
+
+//The pixels of a ring around a centre as runs along each row, so the per pixel stages can skip everything
+//the ball or the 0 can never be in. The ring is drawn with cv::circle, so it covers exactly the pixels that
+//drawing the circles onto the image would. Only rebuilt when the size, centre or radii change.
+class AnnulusSpans
+{
+public:
+	AnnulusSpans();
+
+	//innerRadius < 0 for no hole, outerRadius <= 0 to reach the edges of the image.
+	//Returns true if the spans were rebuilt.
+	bool Prepare(cv::Size size, cv::Point center, int innerRadius, int outerRadius);
+
+	//Spans of row y in x order
+	const Span* RowBegin(int y) const { return spans.data() + rowStarts[y]; }
+	const Span* RowEnd(int y) const { return spans.data() + rowStarts[y + 1]; }
+
+	cv::Size GetSize() const { return size; }
+
+	//Whether an image of the given size at origin lies within the image the spans were built for
+	bool Covers(cv::Point origin, cv::Size imageSize) const
+	{
+		return origin.x >= 0 && origin.y >= 0 && origin.x + imageSize.width <= size.width && origin.y + imageSize.height <= size.height;
+	}
+
+	//Changes every time the spans are rebuilt
+	int GetVersion() const { return version; }
+
+	//CV_8UC1, 255 on the ring and 0 elsewhere, for the code paths that work on whole images
+	const cv::Mat& GetMask() const { return mask; }
+
+private:
+	std::vector<Span> spans;
+	//index of the first span of each row, with one extra entry for the end of the last row
+	std::vector<int> rowStarts;
+	cv::Mat mask;
+
+	cv::Size size;
+	cv::Point center;
+	int innerRadius;
+	int outerRadius;
+	int version;
+};
+
+//Calls rowFunction(begin, end) for each span of row y of an image that sits at origin within the spans,
+//with the span clipped to the image's width cols and made relative to its left edge
+template <typename RowFunction>
+void ForEachSpan(const AnnulusSpans& spans, cv::Point origin, int y, int cols, RowFunction rowFunction)
+{
+	int row = y + origin.y;
+	for (const Span* span = spans.RowBegin(row); span != spans.RowEnd(row); span++)
+	{
+		int begin = std::max(span->begin - origin.x, 0);
+		int end = std::min(span->end - origin.x, cols);
+		if (begin < end)
+		{
+			rowFunction(begin, end);
+		}
+	}
+}
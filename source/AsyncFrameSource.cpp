@@ -0,0 +1,61 @@
+#include "AsyncFrameSource.h"
+
+#include <utility>
+
+AsyncFrameSource::AsyncFrameSource(std::unique_ptr<FrameSource> source)
+	: source(std::move(source)), running(true), finished(false), droppedFrames(0)
+{
+	captureThread = std::thread(&AsyncFrameSource::CaptureLoop, this);
+}
+
+AsyncFrameSource::~AsyncFrameSource()
+{
+	running = false;
+	captureThread.join();
+}
+
+void AsyncFrameSource::CaptureLoop()
+{
+	while (running)
+	{
+		if (!source->Grab(frames.GetWriteSlot()))
+		{
+			break;
+		}
+
+		if (frames.Publish())
+		{
+			droppedFrames.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(waitMutex);
+		}
+		frameReady.notify_one();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(waitMutex);
+		finished = true;
+	}
+	frameReady.notify_one();
+}
+
+bool AsyncFrameSource::Grab(Frame& frame)
+{
+	if (!frames.HasFreshValue())
+	{
+		std::unique_lock<std::mutex> lock(waitMutex);
+		frameReady.wait(lock, [this]() { return frames.HasFreshValue() || finished; });
+	}
+
+	if (!frames.Acquire())
+	{
+		return false;
+	}
+
+	//Hand over the freshest frame and keep the caller's old buffer for the capture thread to reuse
+	std::swap(frame, frames.GetReadSlot());
+
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "FrameSource.h"
+#include "TripleBuffer.h"
+
+//Runs another source on its own capture thread so slow processing never delays the next capture.
+//Frames are handed over through a triple buffer: the capture thread always has a slot to write into,
+//and Grab always returns the most recent complete frame, skipping any the tracker was too slow for.
+//Grab swaps buffers with the caller's Frame, so the previous frame's image is recycled by the capture thread.
+class AsyncFrameSource : public FrameSource
+{
+public:
+	AsyncFrameSource(std::unique_ptr<FrameSource> source);
+	~AsyncFrameSource();
+
+	bool Grab(Frame& frame) override;
+	bool IsLive() const override { return source->IsLive(); }
+
+	//Frames that were captured but replaced by a newer one before the tracker got to them
+	long long GetDroppedFrames() const { return droppedFrames.load(std::memory_order_relaxed); }
+
+private:
+	void CaptureLoop();
+
+	std::unique_ptr<FrameSource> source;
+
+	TripleBuffer<Frame> frames;
+
+	std::atomic<bool> running;
+	std::atomic<bool> finished;
+	std::atomic<long long> droppedFrames;
+
+	//only used to sleep while waiting for a new frame, never held while touching the frames
+	std::mutex waitMutex;
+	std::condition_variable frameReady;
+
+	std::thread captureThread;
+};
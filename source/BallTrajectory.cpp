@@ -0,0 +1,188 @@
+#include "BallTrajectory.h"
+
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+
+const static double GRAVITY = 9.81;
+//Fastest ball the rim tables cover in radians per second, well over the 3 turns a second of a hard launch
+const static double MAX_SPEED = 40.0;
+//Entries in the rim tables
+const static int SPEED_STEPS = 4096;
+//Integration steps between table entries
+const static int SUBSTEPS = 8;
+//Time step for the descent, and how long it may take before the constants are given up on
+const static double DESCENT_STEP = 1e-4;
+const static double MAX_DESCENT_TIME = 10.0;
+
+static void ReadConstant(const cv::FileStorage& file, const char* name, double& value)
+{
+	cv::FileNode node = file[name];
+	if (!node.empty())
+	{
+		node >> value;
+	}
+}
+
+bool LoadWheelConstants(const std::string& path, WheelConstants& constants)
+{
+	cv::FileStorage file;
+	if (!file.open(path, cv::FileStorage::READ))
+	{
+		return false;
+	}
+
+	ReadConstant(file, "rimRadius", constants.rimRadius);
+	ReadConstant(file, "deflectorRadius", constants.deflectorRadius);
+	ReadConstant(file, "statorIncline", constants.statorIncline);
+	ReadConstant(file, "rollingFriction", constants.rollingFriction);
+	ReadConstant(file, "airDrag", constants.airDrag);
+	return true;
+}
+
+bool SaveWheelConstants(const std::string& path, const WheelConstants& constants)
+{
+	cv::FileStorage file;
+	if (!file.open(path, cv::FileStorage::WRITE))
+	{
+		return false;
+	}
+
+	file << "rimRadius" << constants.rimRadius;
+	file << "deflectorRadius" << constants.deflectorRadius;
+	file << "statorIncline" << constants.statorIncline;
+	file << "rollingFriction" << constants.rollingFriction;
+	file << "airDrag" << constants.airDrag;
+	return true;
+}
+
+BallTrajectory::BallTrajectory(const WheelConstants& constants)
+	: constants(constants)
+{
+	valid = false;
+	speedStep = 0;
+	descentTime = 0;
+	descentAngle = 0;
+
+	leaveSpeed = std::sqrt(GRAVITY * std::tan(constants.statorIncline) / constants.rimRadius);
+
+	bool sensible = constants.rimRadius > 0 && constants.deflectorRadius > 0 && constants.deflectorRadius < constants.rimRadius
+		&& constants.statorIncline > 0 && constants.rollingFriction >= 0 && constants.airDrag >= 0
+		&& constants.rollingFriction + constants.airDrag > 0 && leaveSpeed < MAX_SPEED;
+	if (!sensible)
+	{
+		return;
+	}
+
+	BuildRimTables();
+	valid = IntegrateDescent();
+}
+
+double BallTrajectory::Deceleration(double speed) const
+{
+	return constants.rollingFriction + constants.airDrag * speed * speed;
+}
+
+void BallTrajectory::BuildRimTables()
+{
+	//With speed' = -D(speed), the time from speed down to the leave speed is the integral of 1 / D
+	//and the angle covered the integral of speed / D, both over [leave speed, speed]
+	speedStep = (MAX_SPEED - leaveSpeed) / (SPEED_STEPS - 1);
+	rimTimes.assign(SPEED_STEPS, 0.0);
+	rimAngles.assign(SPEED_STEPS, 0.0);
+
+	double h = speedStep / SUBSTEPS;
+	for (int i = 1; i < SPEED_STEPS; i++)
+	{
+		double time = 0;
+		double angle = 0;
+		for (int j = 0; j < SUBSTEPS; j++)
+		{
+			//Simpson's rule over each substep
+			double low = leaveSpeed + (i - 1) * speedStep + j * h;
+			double middle = low + h / 2;
+			double high = low + h;
+			time += h / 6 * (1 / Deceleration(low) + 4 / Deceleration(middle) + 1 / Deceleration(high));
+			angle += h / 6 * (low / Deceleration(low) + 4 * middle / Deceleration(middle) + high / Deceleration(high));
+		}
+		rimTimes[i] = rimTimes[i - 1] + time;
+		rimAngles[i] = rimAngles[i - 1] + angle;
+	}
+}
+
+bool BallTrajectory::IntegrateDescent()
+{
+	double cosIncline = std::cos(constants.statorIncline);
+	double sinIncline = std::sin(constants.statorIncline);
+
+	//(radius, radial velocity, angle, speed), starting at the rim with nothing pushing it in yet
+	double state[4] = { constants.rimRadius, 0, 0, leaveSpeed };
+	double time = 0;
+
+	while (state[0] > constants.deflectorRadius)
+	{
+		if (time > MAX_DESCENT_TIME || state[3] <= 0)
+		{
+			return false;
+		}
+
+		//Classic fourth order Runge-Kutta
+		double k[4][4];
+		double stage[4];
+		for (int s = 0; s < 4; s++)
+		{
+			double fraction = s == 0 ? 0 : (s == 3 ? 1 : 0.5);
+			for (int v = 0; v < 4; v++)
+			{
+				stage[v] = s == 0 ? state[v] : state[v] + fraction * DESCENT_STEP * k[s - 1][v];
+			}
+
+			k[s][0] = stage[1];
+			k[s][1] = stage[0] * stage[3] * stage[3] * cosIncline - GRAVITY * sinIncline;
+			k[s][2] = stage[3];
+			k[s][3] = -Deceleration(stage[3]);
+		}
+
+		double previousRadius = state[0];
+		double previousAngle = state[2];
+		for (int v = 0; v < 4; v++)
+		{
+			state[v] += DESCENT_STEP / 6 * (k[0][v] + 2 * k[1][v] + 2 * k[2][v] + k[3][v]);
+		}
+		time += DESCENT_STEP;
+
+		if (state[0] <= constants.deflectorRadius)
+		{
+			//Back up to where the deflector radius was crossed within the step
+			double fraction = (previousRadius - constants.deflectorRadius) / (previousRadius - state[0]);
+			descentTime = time - DESCENT_STEP * (1 - fraction);
+			descentAngle = previousAngle + (state[2] - previousAngle) * fraction;
+		}
+	}
+
+	return true;
+}
+
+void BallTrajectory::GetRimPhase(double speed, double& seconds, double& angle) const
+{
+	if (!valid || speed <= leaveSpeed)
+	{
+		seconds = 0;
+		angle = 0;
+		return;
+	}
+
+	double position = (speed - leaveSpeed) / speedStep;
+	int index = (int)position;
+	if (index >= SPEED_STEPS - 1)
+	{
+		//Faster than the tables go, which a real spin never is
+		seconds = rimTimes.back();
+		angle = rimAngles.back();
+		return;
+	}
+
+	double fraction = position - index;
+	seconds = rimTimes[index] + (rimTimes[index + 1] - rimTimes[index]) * fraction;
+	angle = rimAngles[index] + (rimAngles[index + 1] - rimAngles[index]) * fraction;
+}
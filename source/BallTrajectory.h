@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//Measurements of one wheel for the ball model, lengths in metres
+struct WheelConstants
+{
+	//radius the centre of the ball runs at while it is in the rim
+	double rimRadius;
+	//radius of the deflectors on the stator, where the ball is taken to drop onto the rotor
+	double deflectorRadius;
+	//incline of the stator to the horizontal, in radians
+	double statorIncline;
+	//the ball slows by rollingFriction + airDrag * speed^2 radians per second per second
+	double rollingFriction;
+	double airDrag;
+
+	//A standard casino wheel
+	WheelConstants()
+	{
+		rimRadius = 0.41;
+		deflectorRadius = 0.33;
+		statorIncline = 0.2;
+		rollingFriction = 0.5;
+		airDrag = 0.002;
+	}
+};
+
+//Reads and writes the constants as an OpenCV FileStorage file (YAML or XML by the extension), as written by
+//Physics_Fitter. Any constant missing from the file keeps the value it had. Both return false if the file couldn't be opened.
+bool LoadWheelConstants(const std::string& path, WheelConstants& constants);
+bool SaveWheelConstants(const std::string& path, const WheelConstants& constants);
+
+//The ball model from resources/roulette_paper.pdf: the ball runs round the rim slowing from rolling friction and
+//air drag until its speed drops to where the rim can no longer hold it (speed^2 = g tan(incline) / rimRadius),
+//then rolls in down the stator (r'' = r speed^2 cos(incline) - g sin(incline)) until it reaches the deflectors.
+//Time and angle from any speed in the rim to leaving it are integrated once into tables when the solver is made,
+//and the descent is the same for every spin, so a prediction is two table lookups. Angles are in radians.
+class BallTrajectory
+{
+public:
+	explicit BallTrajectory(const WheelConstants& constants);
+
+	//False if the constants don't describe a ball that ever reaches the deflectors
+	bool IsValid() const { return valid; }
+
+	const WheelConstants& GetConstants() const { return constants; }
+
+	//Speed in radians per second at which the ball leaves the rim
+	double GetLeaveSpeed() const { return leaveSpeed; }
+
+	//Seconds and radians from being in the rim at speed until leaving it, 0 at or below the leave speed
+	void GetRimPhase(double speed, double& seconds, double& angle) const;
+
+	//Seconds and radians from leaving the rim until reaching the deflectors
+	double GetDescentTime() const { return descentTime; }
+	double GetDescentAngle() const { return descentAngle; }
+
+private:
+	double Deceleration(double speed) const;
+	void BuildRimTables();
+	bool IntegrateDescent();
+
+	WheelConstants constants;
+	bool valid;
+	double leaveSpeed;
+
+	//time and angle from leaving speed + i * speedStep down to the leave speed
+	std::vector<double> rimTimes;
+	std::vector<double> rimAngles;
+	double speedStep;
+
+	double descentTime;
+	double descentAngle;
+};
@@ -0,0 +1,140 @@
+#include "BlobFinder.h"
+
+#include <algorithm>
+#include <utility>
+
+int BlobFinder::AddRegion(const Run& run, int y)
+{
+	Region region;
+	region.parent = (int)regions.size();
+	region.area = run.end - run.start + 1;
+	//sum of start..end
+	region.sumX = 0.5 * (run.start + run.end) * region.area;
+	region.sumY = (double)y * region.area;
+	region.minX = run.start;
+	region.maxX = run.end;
+	region.minY = y;
+	region.maxY = y;
+
+	regions.push_back(region);
+	return region.parent;
+}
+
+int BlobFinder::FindRoot(int region)
+{
+	while (regions[region].parent != region)
+	{
+		//path halving keeps the trees flat
+		regions[region].parent = regions[regions[region].parent].parent;
+		region = regions[region].parent;
+	}
+	return region;
+}
+
+void BlobFinder::Merge(int regionA, int regionB)
+{
+	int rootA = FindRoot(regionA);
+	int rootB = FindRoot(regionB);
+	if (rootA == rootB)
+	{
+		return;
+	}
+
+	//Keep the bigger region as the root so the trees stay shallow
+	if (regions[rootA].area < regions[rootB].area)
+	{
+		std::swap(rootA, rootB);
+	}
+
+	Region& root = regions[rootA];
+	const Region& merged = regions[rootB];
+	root.area += merged.area;
+	root.sumX += merged.sumX;
+	root.sumY += merged.sumY;
+	root.minX = std::min(root.minX, merged.minX);
+	root.minY = std::min(root.minY, merged.minY);
+	root.maxX = std::max(root.maxX, merged.maxX);
+	root.maxY = std::max(root.maxY, merged.maxY);
+
+	regions[rootB].parent = rootA;
+}
+
+bool BlobFinder::FindLargest(const cv::Mat& binaryImage, Blob& largest)
+{
+	CV_Assert(binaryImage.type() == CV_8UC1);
+
+	int rows = binaryImage.rows;
+	int cols = binaryImage.cols;
+
+	regions.clear();
+	previousRuns.clear();
+
+	for (int y = 0; y < rows; y++)
+	{
+		const uchar* row = binaryImage.ptr<uchar>(y);
+
+		currentRuns.clear();
+		int x = 0;
+		while (x < cols)
+		{
+			//skip the background, which is most of the image
+			while (x < cols && row[x] == 0)
+			{
+				x++;
+			}
+			if (x == cols)
+			{
+				break;
+			}
+
+			Run run;
+			run.start = x;
+			while (x < cols && row[x] != 0)
+			{
+				x++;
+			}
+			run.end = x - 1;
+			run.region = AddRegion(run, y);
+			currentRuns.push_back(run);
+		}
+
+		//Join each run to every run above it that touches it, diagonals included.
+		//Both lists are sorted by position, so one sweep finds all the overlaps.
+		size_t above = 0;
+		for (const Run& run : currentRuns)
+		{
+			while (above < previousRuns.size() && previousRuns[above].end < run.start - 1)
+			{
+				above++;
+			}
+
+			for (size_t i = above; i < previousRuns.size() && previousRuns[i].start <= run.end + 1; i++)
+			{
+				Merge(run.region, previousRuns[i].region);
+			}
+		}
+
+		previousRuns.swap(currentRuns);
+	}
+
+	int largestRegion = -1;
+	for (int i = 0; i < (int)regions.size(); i++)
+	{
+		if (regions[i].parent == i && (largestRegion == -1 || regions[i].area > regions[largestRegion].area))
+		{
+			largestRegion = i;
+		}
+	}
+
+	if (largestRegion == -1)
+	{
+		return false;
+	}
+
+	const Region& region = regions[largestRegion];
+	largest.area = region.area;
+	largest.centroid = cv::Point2f((float)(region.sumX / region.area), (float)(region.sumY / region.area));
+	largest.boundingBox = cv::Rect(region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1);
+
+	return true;
+}
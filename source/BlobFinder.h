@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+//A connected region of set pixels
+struct Blob
+{
+	int area;
+	cv::Point2f centroid;
+	cv::Rect boundingBox;
+
+	Blob()
+	{
+		area = 0;
+	}
+};
+
+//Finds the largest 8-connected region of a binary image in a single pass over it. Each row is split into
+//runs of set pixels, runs touching one in the row above are merged with a union-find, and the area,
+//centroid and bounding box are accumulated as the regions merge, so no label image is ever written.
+//The buffers are kept between calls.
+class BlobFinder
+{
+public:
+	//Returns false if binaryImage (CV_8UC1) has no set pixels
+	bool FindLargest(const cv::Mat& binaryImage, Blob& largest);
+
+private:
+	struct Run
+	{
+		int start;
+		//inclusive
+		int end;
+		int region;
+	};
+
+	struct Region
+	{
+		int parent;
+		int area;
+		double sumX;
+		double sumY;
+		int minX, minY, maxX, maxY;
+	};
+
+	int AddRegion(const Run& run, int y);
+	int FindRoot(int region);
+	void Merge(int regionA, int regionB);
+
+	std::vector<Run> previousRuns;
+	std::vector<Run> currentRuns;
+	std::vector<Region> regions;
+};
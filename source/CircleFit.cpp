@@ -0,0 +1,114 @@
+#include "CircleFit.h"
+
+#include <algorithm>
+#include <cmath>
+
+CircleFit::CircleFit(double forgetting)
+{
+	this->forgetting = forgetting;
+	Clear();
+}
+
+void CircleFit::Clear()
+{
+	count = 0;
+	weight = 0;
+	sumX = sumY = sumXX = sumYY = sumXY = 0;
+	sumZ = sumXZ = sumYZ = sumZZ = 0;
+
+	center = cv::Point2f(-1, -1);
+	radius = 0;
+	residual = 0;
+}
+
+void CircleFit::Add(cv::Point2f point)
+{
+	if (count == 0)
+	{
+		origin = cv::Point2d(point.x, point.y);
+	}
+	count++;
+
+	double x = point.x - origin.x;
+	double y = point.y - origin.y;
+	double z = x * x + y * y;
+
+	weight = weight * forgetting + 1;
+	sumX = sumX * forgetting + x;
+	sumY = sumY * forgetting + y;
+	sumXX = sumXX * forgetting + x * x;
+	sumYY = sumYY * forgetting + y * y;
+	sumXY = sumXY * forgetting + x * y;
+	sumZ = sumZ * forgetting + z;
+	sumXZ = sumXZ * forgetting + x * z;
+	sumYZ = sumYZ * forgetting + y * z;
+	sumZZ = sumZZ * forgetting + z * z;
+}
+
+bool CircleFit::Solve()
+{
+	if (count < 3)
+	{
+		return false;
+	}
+
+	//Minimise sum (z + D x + E y + F)^2, working with weighted means so the system's scale doesn't depend on the point count
+	double meanX = sumX / weight;
+	double meanY = sumY / weight;
+	double meanXX = sumXX / weight;
+	double meanYY = sumYY / weight;
+	double meanXY = sumXY / weight;
+	double meanZ = sumZ / weight;
+	double meanXZ = sumXZ / weight;
+	double meanYZ = sumYZ / weight;
+	double meanZZ = sumZZ / weight;
+
+	cv::Matx33d normal(meanXX, meanXY, meanX,
+	                   meanXY, meanYY, meanY,
+	                   meanX, meanY, 1.0);
+	cv::Vec3d right(-meanXZ, -meanYZ, -meanZ);
+
+	//Points on a line (or all in one place) leave the system singular. Compare against the spread
+	//of the points so the test doesn't depend on the size of the circle.
+	double spread = meanXX - meanX * meanX + meanYY - meanY * meanY;
+	double determinant = cv::determinant(normal);
+	if (spread <= 0 || std::fabs(determinant) < 1e-6 * spread * spread)
+	{
+		return false;
+	}
+
+	//Cramer's rule, a 3x3 system doesn't need anything heavier
+	double solution[3];
+	for (int i = 0; i < 3; i++)
+	{
+		cv::Matx33d replaced = normal;
+		for (int row = 0; row < 3; row++)
+		{
+			replaced(row, i) = right[row];
+		}
+		solution[i] = cv::determinant(replaced) / determinant;
+	}
+
+	double d = solution[0];
+	double e = solution[1];
+	double f = solution[2];
+
+	double centerX = -d / 2;
+	double centerY = -e / 2;
+	double radiusSquared = centerX * centerX + centerY * centerY - f;
+	if (radiusSquared <= 0)
+	{
+		return false;
+	}
+
+	center = cv::Point2f((float)(centerX + origin.x), (float)(centerY + origin.y));
+	radius = (float)std::sqrt(radiusSquared);
+
+	//Mean of (z + D x + E y + F)^2 from the sums. Each term is about 2 r times the point's distance from the circle.
+	double algebraic = meanZZ + d * d * meanXX + e * e * meanYY + f * f
+		+ 2 * d * meanXZ + 2 * e * meanYZ + 2 * f * meanZ
+		+ 2 * d * e * meanXY + 2 * d * f * meanX + 2 * e * f * meanY;
+	residual = (float)(std::sqrt(std::max(algebraic, 0.0)) / (2 * radius));
+
+	return true;
+}
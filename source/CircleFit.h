@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+//Least squares circle through a stream of points (Kasa's algebraic fit), kept as running sums so adding a
+//point is O(1) however many came before. Older points fade out by the forgetting factor each time a point
+//is added, so the fit follows a wheel that moves in the frame and the sums never grow without bound.
+class CircleFit
+{
+public:
+	//forgetting is the weight kept by the existing points each time a new one arrives, 1 to never forget
+	explicit CircleFit(double forgetting);
+
+	void Clear();
+	void Add(cv::Point2f point);
+
+	//Number of points added since the last Clear
+	int GetCount() const { return count; }
+
+	//Solves for the circle through the points so far. Returns false if there are too few of them
+	//or they are too close to a straight line to pick out a centre.
+	bool Solve();
+
+	//Results of the last successful Solve
+	cv::Point2f GetCenter() const { return center; }
+	float GetRadius() const { return radius; }
+	//Root mean square distance of the points from the circle in pixels, approximated from the algebraic fit
+	float GetResidual() const { return residual; }
+
+private:
+	double forgetting;
+	int count;
+
+	//Sums are taken relative to the first point so they stay well conditioned far from the image origin
+	cv::Point2d origin;
+	double weight;
+	double sumX, sumY, sumXX, sumYY, sumXY;
+	//z = x^2 + y^2
+	double sumZ, sumXZ, sumYZ, sumZZ;
+
+	cv::Point2f center;
+	float radius;
+	float residual;
+};
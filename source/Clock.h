@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+
+//All tracker timing is expressed as points on the steady clock. Replayed sessions use the
+//recorded capture times as offsets from the clock's epoch.
+typedef std::chrono::steady_clock::time_point Timestamp;
+
+//Time source used to stamp live frames at the moment they are captured
+class Clock
+{
+public:
+	virtual ~Clock() {}
+
+	virtual Timestamp Now() const = 0;
+};
+
+//Wall time, for live capture
+class SteadyClock : public Clock
+{
+public:
+	Timestamp Now() const override
+	{
+		return std::chrono::steady_clock::now();
+	}
+};
+
+//Converts a recorded capture time in milliseconds since the start of the recording into a Timestamp
+inline Timestamp TimestampFromMilliseconds(double milliseconds)
+{
+	return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::duration<double, std::milli>(milliseconds)));
+}
@@ -0,0 +1,108 @@
+#include "ColourMask.h"
+
+#include <algorithm>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+HsvRangeMask::HsvRangeMask()
+{
+}
+
+void HsvRangeMask::Build(cv::Scalar lowerBound, cv::Scalar upperBound)
+{
+	builtLowerBound = lowerBound;
+	builtUpperBound = upperBound;
+
+	colourInRange.assign((1 << 24) / 8, 0);
+
+	//One 256x256 image per blue value, with green along the columns and red down the rows
+	cv::Mat colours(256, 256, CV_8UC3);
+	cv::Mat hsv;
+	cv::Mat slice;
+
+	for (int b = 0; b < 256; b++)
+	{
+		for (int r = 0; r < 256; r++)
+		{
+			uchar* pixel = colours.ptr<uchar>(r);
+			for (int g = 0; g < 256; g++, pixel += 3)
+			{
+				pixel[0] = (uchar)b;
+				pixel[1] = (uchar)g;
+				pixel[2] = (uchar)r;
+			}
+		}
+
+		cv::cvtColor(colours, hsv, cv::COLOR_BGR2HSV);
+		cv::inRange(hsv, lowerBound, upperBound, slice);
+
+		for (int r = 0; r < 256; r++)
+		{
+			const uchar* isInRange = slice.ptr<uchar>(r);
+			for (int g = 0; g < 256; g++)
+			{
+				if (isInRange[g] != 0)
+				{
+					int index = (b << 16) | (g << 8) | r;
+					colourInRange[index >> 3] |= (uchar)(1 << (index & 7));
+				}
+			}
+		}
+	}
+}
+
+void HsvRangeMask::Prepare(const cv::Mat& frame, cv::Scalar lowerBound, cv::Scalar upperBound)
+{
+	CV_Assert(frame.depth() == CV_8U && (frame.channels() == 3 || frame.channels() == 4));
+
+	if (colourInRange.empty() || lowerBound != builtLowerBound || upperBound != builtUpperBound)
+	{
+		Build(lowerBound, upperBound);
+	}
+}
+
+void HsvRangeMask::LookUp(const uchar* pixel, int channels, uchar* destination, int count) const
+{
+	const uchar* table = colourInRange.data();
+
+	for (int x = 0; x < count; x++, pixel += channels)
+	{
+		int index = (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+		destination[x] = (table[index >> 3] >> (index & 7)) & 1 ? 255 : 0;
+	}
+}
+
+void HsvRangeMask::Apply(const cv::Mat& frame, cv::Mat& mask, cv::Scalar lowerBound, cv::Scalar upperBound)
+{
+	Prepare(frame, lowerBound, upperBound);
+
+	mask.create(frame.size(), CV_8UC1);
+	for (int y = 0; y < frame.rows; y++)
+	{
+		LookUp(frame.ptr<uchar>(y), frame.channels(), mask.ptr<uchar>(y), frame.cols);
+	}
+}
+
+void HsvRangeMask::Apply(const cv::Mat& frame, cv::Mat& mask, cv::Scalar lowerBound, cv::Scalar upperBound, const AnnulusSpans& ring, cv::Point origin)
+{
+	CV_Assert(ring.Covers(origin, frame.size()));
+	Prepare(frame, lowerBound, upperBound);
+
+	int channels = frame.channels();
+
+	mask.create(frame.size(), CV_8UC1);
+	for (int y = 0; y < frame.rows; y++)
+	{
+		const uchar* pixels = frame.ptr<uchar>(y);
+		uchar* destination = mask.ptr<uchar>(y);
+
+		int x = 0;
+		ForEachSpan(ring, origin, y, frame.cols, [&](int begin, int end)
+		{
+			std::fill(destination + x, destination + begin, 0);
+			LookUp(pixels + begin * channels, channels, destination + begin, end - begin);
+			x = end;
+		});
+		std::fill(destination + x, destination + frame.cols, 0);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AnnulusSpans.h"
+
+//cv::inRange on the HSV version of a frame, without converting the frame to HSV.
+//Whether a colour is in range only depends on its BGR value, so the answer for all 2^24 colours is
+//worked out once with cvtColor + inRange themselves and kept as a bit table (2MB). Looking up a pixel
+//then gives exactly the mask the OpenCV calls would.
+class HsvRangeMask
+{
+public:
+	HsvRangeMask();
+
+	//frame is CV_8UC3 or CV_8UC4 (BGR or BGRA), mask becomes CV_8UC1 with 255 where the colour is in range.
+	//The table is rebuilt whenever the bounds change.
+	void Apply(const cv::Mat& frame, cv::Mat& mask, cv::Scalar lowerBound, cv::Scalar upperBound);
+
+	//Same, but only looks up the pixels on ring, with frame sitting at origin within the ring's image.
+	//The rest of mask is 0.
+	void Apply(const cv::Mat& frame, cv::Mat& mask, cv::Scalar lowerBound, cv::Scalar upperBound, const AnnulusSpans& ring, cv::Point origin);
+
+private:
+	void Build(cv::Scalar lowerBound, cv::Scalar upperBound);
+	void Prepare(const cv::Mat& frame, cv::Scalar lowerBound, cv::Scalar upperBound);
+	void LookUp(const uchar* pixel, int channels, uchar* destination, int count) const;
+
+	//one bit per colour, indexed by (b << 16) | (g << 8) | r
+	std::vector<uchar> colourInRange;
+	cv::Scalar builtLowerBound;
+	cv::Scalar builtUpperBound;
+};
@@ -0,0 +1,237 @@
+#include "EmpiricalPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+//Seconds between the ball lap speeds describing a spin
+const static double FEATURE_SPACING = 0.5;
+//The ball has left the track once it hasn't been seen for this long...
+const static double BALL_GONE_SECONDS = 0.5;
+//...and the model has it leaving within this long of its last sighting. Otherwise it was only lost on the track
+//(a reflection, or a dropped detection), and its last sighting is too far from the drop to place it.
+const static double MAX_SECONDS_TO_LEAVE = 1.0;
+//Added to the distance in degrees per second when weighting a vote, so an exact match doesn't outvote everything
+const static float VOTE_SOFTENING = 1.f;
+//A gap this long between ball timings is a new spin, as when spins are read back from the log
+const static double NEW_SPIN_GAP = 5.0;
+//The ball only ever slows down during a spin, so a lap this much faster than the one before is a new launch
+const static float RELAUNCH_SPEED_RATIO = 1.5f;
+
+static float WrapAngle(float angle)
+{
+	angle = std::fmod(angle, 360.f);
+	return angle < 0 ? angle + 360.f : angle;
+}
+
+//Where the 0 is at time, carried on from its latest sighting at the rotor's speed
+static float GetZeroAngle(const SpinTracker& spinTracker, float rotorVelocity, Timestamp time)
+{
+	const TrackStore& zeroPoints = spinTracker.innerWheelPoints;
+	double seconds = std::chrono::duration<double>(time - zeroPoints.time.back()).count();
+	return (float)(zeroPoints.angle.back() + rotorVelocity * seconds);
+}
+
+EmpiricalPredictor::EmpiricalPredictor(SpinIndex& index, const PocketPredictor& predictor)
+	: index(index), predictor(predictor)
+{
+	referenceSpeed = 400.f;
+	neighbours = 16;
+
+	votes.assign(predictor.GetPocketCount(), 0.f);
+	Reset();
+}
+
+void EmpiricalPredictor::Reset()
+{
+	hasBallTiming = false;
+	StartSpin();
+}
+
+void EmpiricalPredictor::StartSpin()
+{
+	direction = 1.f;
+	referenced = false;
+	referenceAngle = 0;
+	predicted = false;
+	voterCount = 0;
+	finished = false;
+}
+
+bool EmpiricalPredictor::DetectNewSpin(const SpinTracker& spinTracker)
+{
+	const RingBuffer<FinishedPoint>& ballSpeeds = spinTracker.ballSpeeds;
+	if (ballSpeeds.IsEmpty())
+	{
+		//Spin tracking was reset, so the spin so far is gone
+		bool reset = hasBallTiming;
+		hasBallTiming = false;
+		return reset;
+	}
+
+	const FinishedPoint& latest = ballSpeeds.Back();
+	if (hasBallTiming && latest.time == lastBallTime)
+	{
+		return false;
+	}
+
+	bool newSpin = false;
+	if (!hasBallTiming)
+	{
+		spinStart = latest.time;
+	}
+	else if (std::chrono::duration<double>(latest.time - lastBallTime).count() > NEW_SPIN_GAP)
+	{
+		newSpin = true;
+	}
+	else if (ballSpeeds.Size() >= 2)
+	{
+		const FinishedPoint& previous = ballSpeeds[ballSpeeds.Size() - 2];
+		newSpin = latest.timeAround > 0 && previous.timeAround > 0 && latest.timeAround * RELAUNCH_SPEED_RATIO < previous.timeAround;
+	}
+
+	if (newSpin)
+	{
+		spinStart = latest.time;
+	}
+	hasBallTiming = true;
+	lastBallTime = latest.time;
+	return newSpin;
+}
+
+bool EmpiricalPredictor::Describe(const SpinTracker& spinTracker, float rotorVelocity, float& ballRelativeAngle)
+{
+	const RingBuffer<FinishedPoint>& ballSpeeds = spinTracker.ballSpeeds;
+	if (ballSpeeds.IsEmpty() || spinTracker.innerWheelPoints.IsEmpty() || !spinTracker.ballMotion.IsValid())
+	{
+		return false;
+	}
+
+	const FinishedPoint& latest = ballSpeeds.Back();
+	if (latest.timeAround <= 0 || 360000.f / latest.timeAround > referenceSpeed)
+	{
+		return false;
+	}
+
+	features[0] = 360000.f / latest.timeAround;
+
+	//Earlier lap speeds, which the spin has to have been timed for long enough to have
+	int point = ballSpeeds.Size() - 1;
+	for (int feature = 1; feature < SpinIndex::FEATURES - 1; feature++)
+	{
+		Timestamp target = latest.time - std::chrono::duration_cast<Timestamp::duration>(std::chrono::duration<double>(feature * FEATURE_SPACING));
+		while (point >= 0 && ballSpeeds[point].time > target)
+		{
+			point--;
+		}
+		if (point < 0 || ballSpeeds[point].time < spinStart || ballSpeeds[point].timeAround <= 0)
+		{
+			//Picked up too late to describe at the reference speed, so this spin is left out altogether
+			finished = true;
+			return false;
+		}
+		features[feature] = 360000.f / ballSpeeds[point].timeAround;
+	}
+
+	direction = spinTracker.ballMotion.GetAngularVelocity() < 0 ? -1.f : 1.f;
+	features[SpinIndex::FEATURES - 1] = rotorVelocity * direction;
+
+	ballRelativeAngle = WrapAngle(direction * (latest.angle - GetZeroAngle(spinTracker, rotorVelocity, latest.time)));
+	return true;
+}
+
+void EmpiricalPredictor::Vote(float ballRelativeAngle)
+{
+	int indices[SpinIndex::MAX_NEIGHBOURS];
+	float distances[SpinIndex::MAX_NEIGHBOURS];
+	voterCount = index.FindNearest(features, neighbours, indices, distances);
+
+	std::fill(votes.begin(), votes.end(), 0.f);
+	float total = 0;
+	for (int i = 0; i < voterCount; i++)
+	{
+		//The past spin's outcome played out from where this spin's ball is, turned back into ToPolar's direction
+		float landingAngle = direction * (ballRelativeAngle + index.GetOutcome(indices[i]));
+		float weight = 1.f / (std::sqrt(distances[i]) + VOTE_SOFTENING);
+		votes[predictor.GetPocketIndex(landingAngle, 0)] += weight;
+		total += weight;
+	}
+
+	for (float& vote : votes)
+	{
+		vote /= total;
+	}
+	predicted = voterCount > 0;
+}
+
+bool EmpiricalPredictor::GetOutcome(Timestamp now, const SpinTracker& spinTracker, float rotorVelocity, float& ballRelativeAngle) const
+{
+	const AngularMotionFit& ball = spinTracker.ballMotion;
+	if (!ball.IsValid() || spinTracker.innerWheelPoints.IsEmpty())
+	{
+		return false;
+	}
+
+	Timestamp lastSighting = ball.GetLastTime();
+	if (lastSighting < spinStart || std::chrono::duration<double>(now - lastSighting).count() < BALL_GONE_SECONDS)
+	{
+		return false;
+	}
+
+	//From the last sighting on, as PocketPredictor::Predict would have seen it then
+	double velocity = ball.PredictAngularVelocity(lastSighting);
+	double secondsToLeave, secondsToLand, travel;
+	if (!predictor.Project(std::fabs(velocity), ball.GetDeceleration(), secondsToLeave, secondsToLand, travel) || secondsToLeave > MAX_SECONDS_TO_LEAVE)
+	{
+		return false;
+	}
+
+	double ballDirection = velocity < 0 ? -1.0 : 1.0;
+	float landingAngle = (float)(ball.PredictAngle(lastSighting) + ballDirection * travel);
+	Timestamp landingTime = lastSighting + std::chrono::duration_cast<Timestamp::duration>(std::chrono::duration<double>(secondsToLand));
+	ballRelativeAngle = WrapAngle(direction * (landingAngle - GetZeroAngle(spinTracker, rotorVelocity, landingTime)));
+	return true;
+}
+
+bool EmpiricalPredictor::Update(Timestamp now, const SpinTracker& spinTracker, bool rotorValid, float rotorVelocity)
+{
+	if (DetectNewSpin(spinTracker))
+	{
+		StartSpin();
+	}
+
+	if (!rotorValid || finished)
+	{
+		return false;
+	}
+
+	if (!referenced)
+	{
+		float ballRelativeAngle;
+		if (!Describe(spinTracker, rotorVelocity, ballRelativeAngle))
+		{
+			return false;
+		}
+
+		referenced = true;
+		referenceAngle = ballRelativeAngle;
+		if (index.GetSize() > 0)
+		{
+			Vote(ballRelativeAngle);
+		}
+		return predicted;
+	}
+
+	//Wait for the ball to leave the track, then add where it came down as the spin's outcome
+	float ballRelativeAngle;
+	if (GetOutcome(now, spinTracker, rotorVelocity, ballRelativeAngle))
+	{
+		index.Add(features, WrapAngle(ballRelativeAngle - referenceAngle));
+		finished = true;
+	}
+	return false;
+}
+
+int EmpiricalPredictor::GetMostLikely(PocketChance* likely, int count) const
+{
+	return predicted ? GetMostLikelyPockets(votes, predictor.GetPocketOrder(), likely, count) : 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include "Clock.h"
+#include "LandingDistribution.h"
+#include "PocketPredictor.h"
+#include "SpinIndex.h"
+#include "SpinTracker.h"
+
+//Predicts from past spins instead of a model. Each spin is described at the moment its ball's lap speed first drops
+//to referenceSpeed: by the ball's lap speed then and at half second intervals before, and by the rotor's speed.
+//Where the ball comes down on the rotor, measured from where it was against the 0 at that moment, is the spin's outcome.
+//The ball is only searched for on the track, outside the mask over the rotor, so it is never seen in a pocket. Instead
+//the outcome comes from the ball's last sighting on the track once it has been gone for a moment: the predictor's
+//leave and drop model (or its trajectory) carries the ball from that sighting down to the rotor, and the 0 is carried
+//on at the rotor's speed to the same moment. This is the point the model is most sure of, since the ball was seen
+//moments before leaving.
+//The nearest past spins to the current one vote with their outcomes, each weighted by how near it is.
+//Angles are measured in the ball's direction of travel, so spins either way round are compared alike.
+//A new spin is noticed from the ball timings alone (a long gap, or the ball going much faster than the lap before),
+//so a run over many spins describes and indexes every one of them without being reset by hand.
+class EmpiricalPredictor
+{
+public:
+	//Finished spins are added to index, and pockets are worked out as predictor does
+	EmpiricalPredictor(SpinIndex& index, const PocketPredictor& predictor);
+
+	//Ball lap speed in degrees per second at which a spin is described and predicted
+	float referenceSpeed;
+	//Past spins voting on each prediction
+	int neighbours;
+
+	//Forgets the spin so far, e.g. when spin tracking is reset. Whatever is timed next starts a new spin.
+	void Reset();
+
+	//Call every frame while spin tracking, after spinTracker.Update. rotorValid says whether rotorVelocity
+	//(degrees per second) is known. Returns true on the frame the current spin is predicted.
+	bool Update(Timestamp now, const SpinTracker& spinTracker, bool rotorValid, float rotorVelocity);
+
+	//Whether the current spin has been predicted, and the pockets the vote made most likely
+	bool HasPrediction() const { return predicted; }
+	int GetMostLikely(PocketChance* likely, int count) const;
+
+	//Spins the current prediction was made from
+	int GetVoterCount() const { return voterCount; }
+
+private:
+	//Forgets the current spin's description, prediction and outcome
+	void StartSpin();
+	//Returns true if the ball timings since the last call show that a new spin has started
+	bool DetectNewSpin(const SpinTracker& spinTracker);
+	bool Describe(const SpinTracker& spinTracker, float rotorVelocity, float& ballRelativeAngle);
+	void Vote(float ballRelativeAngle);
+	//Where the ball came down against the 0, in its direction, once it has left the track. False while it hasn't.
+	bool GetOutcome(Timestamp now, const SpinTracker& spinTracker, float rotorVelocity, float& ballRelativeAngle) const;
+
+	SpinIndex& index;
+	const PocketPredictor& predictor;
+
+	//the latest ball timing seen, and the first of the current spin, before which nothing describes it
+	bool hasBallTiming;
+	Timestamp lastBallTime;
+	Timestamp spinStart;
+
+	//+1 or -1 for the way the ball goes round ToPolar's angles
+	float direction;
+	//set once the spin has been described at the reference speed
+	bool referenced;
+	float features[SpinIndex::FEATURES];
+	//where the ball was against the 0 when the spin was described, in the ball's direction
+	float referenceAngle;
+
+	bool predicted;
+	std::vector<float> votes;
+	int voterCount;
+
+	//whether the spin has been added to the index, or left out
+	bool finished;
+};
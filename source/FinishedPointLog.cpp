@@ -0,0 +1,89 @@
+#include "FinishedPointLog.h"
+
+FinishedPointLog::FinishedPointLog()
+{
+	stopping = false;
+}
+
+FinishedPointLog::~FinishedPointLog()
+{
+	if (writeThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		recordsQueued.notify_one();
+		writeThread.join();
+	}
+}
+
+bool FinishedPointLog::Open(const std::string& path)
+{
+	file.open(path, std::ios::out | std::ios::app);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	writeThread = std::thread(&FinishedPointLog::WriteLoop, this);
+	return true;
+}
+
+void FinishedPointLog::Queue(const Record& record)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queued.push_back(record);
+	}
+	recordsQueued.notify_one();
+}
+
+void FinishedPointLog::Write(FinishedPointKind kind, const FinishedPoint& point)
+{
+	Record record;
+	record.kind = kind;
+	record.point = point;
+	Queue(record);
+}
+
+void FinishedPointLog::WriteReset(Timestamp time)
+{
+	Record record;
+	record.kind = -1;
+	record.point.time = time;
+	Queue(record);
+}
+
+void FinishedPointLog::WriteLoop()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true)
+	{
+		recordsQueued.wait(lock, [this]() { return !queued.empty() || stopping; });
+		if (queued.empty())
+		{
+			break;
+		}
+
+		queued.swap(written);
+
+		//Only the queue needs the lock, not the disk
+		lock.unlock();
+		for (const Record& record : written)
+		{
+			long long microseconds = std::chrono::duration_cast<std::chrono::microseconds>(record.point.time.time_since_epoch()).count();
+			if (record.kind < 0)
+			{
+				file << "reset," << microseconds << "\n";
+			}
+			else
+			{
+				file << (record.kind == FINISHED_WHEEL ? "wheel," : "ball,") << microseconds << "," << record.point.radius << "," << record.point.angle << "," << record.point.timeAround << "\n";
+			}
+		}
+		file.flush();
+		written.clear();
+		lock.lock();
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SpinTracker.h"
+
+//Appends finished points to a text file on a background thread, so the tracker can drop old history
+//without losing it and without waiting on the disk. One record per line:
+//  wheel,<time us>,<radius>,<angle>,<time around ms>
+//  ball,<time us>,<radius>,<angle>,<time around ms>
+//  reset,<time us>
+//Times are microseconds on the tracker's clock, i.e. since the start of the recording for replays.
+class FinishedPointLog
+{
+public:
+	FinishedPointLog();
+	//Writes out anything still queued
+	~FinishedPointLog();
+
+	//Opens path for appending, returns false if it couldn't be opened
+	bool Open(const std::string& path);
+
+	void Write(FinishedPointKind kind, const FinishedPoint& point);
+	void WriteReset(Timestamp time);
+
+private:
+	struct Record
+	{
+		//-1 for a reset marker
+		int kind;
+		FinishedPoint point;
+	};
+
+	void Queue(const Record& record);
+	void WriteLoop();
+
+	std::ofstream file;
+
+	//records waiting for the writer thread, swapped with written so neither side reallocates once warmed up
+	std::vector<Record> queued;
+	std::vector<Record> written;
+	bool stopping;
+	std::mutex queueMutex;
+	std::condition_variable recordsQueued;
+
+	std::thread writeThread;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+//Layout of a raw frame recording, as written by RecordingFrameSource and mapped by MappedFrameSource.
+//
+//  header, padded to RECORDING_ALIGNMENT
+//  one chunk per frame: FrameChunkHeader padded to FRAME_DATA_OFFSET bytes, then the pixels row after row,
+//  padded to RECORDING_ALIGNMENT so every chunk starts on a page and its pixels start FRAME_DATA_OFFSET (64) bytes in
+//  the file offset of every chunk, then RecordingFooter, once the recording was closed
+//
+//A recording that was never closed (e.g. the tracker crashed) has no index. Its chunks are found by walking
+//from one to the next instead, dropping a last chunk that was only partly written.
+
+const static char RECORDING_MAGIC[8] = { 'P', 'T', 'R', 'E', 'C', 'O', 'R', 'D' };
+const static char FRAME_CHUNK_MAGIC[4] = { 'F', 'R', 'M', 'E' };
+const static char RECORDING_INDEX_MAGIC[8] = { 'P', 'T', 'I', 'N', 'D', 'E', 'X', '1' };
+const static uint32_t RECORDING_VERSION = 1;
+
+const static uint64_t RECORDING_ALIGNMENT = 4096;
+const static uint64_t FRAME_DATA_OFFSET = 64;
+
+struct RecordingHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t alignment;
+};
+
+struct FrameChunkHeader
+{
+	char magic[4];
+	int32_t width;
+	int32_t height;
+	//OpenCV type of the pixels, CV_8UC4 for everything the capture sources hand out
+	int32_t type;
+	//bytes from one row to the next
+	int64_t step;
+	//capture time in microseconds since the first recorded frame
+	int64_t microseconds;
+	//the capture source's frame index, which skips where frames were dropped
+	int64_t index;
+};
+
+struct RecordingFooter
+{
+	//file offset of the first chunk offset
+	uint64_t indexOffset;
+	uint64_t frameCount;
+	char magic[8];
+};
+
+//Bytes a chunk of a frame takes up, padding included
+inline uint64_t GetFrameChunkSize(int64_t step, int32_t height)
+{
+	uint64_t size = FRAME_DATA_OFFSET + (uint64_t)step * (uint64_t)height;
+	return (size + RECORDING_ALIGNMENT - 1) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+}
@@ -0,0 +1,217 @@
+#include "FrameSource.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgcodecs/imgcodecs.hpp>
+
+#ifdef _WIN32
+
+//How often a minimised or empty reference window is checked again
+const static int EMPTY_WINDOW_RETRY_MILLISECONDS = 50;
+
+DesktopFrameSource::DesktopFrameSource(HWND referenceWindow, const Clock& clock)
+	: clock(clock)
+{
+	this->referenceWindow = referenceWindow;
+	Initialise();
+}
+
+DesktopFrameSource::DesktopFrameSource(cv::Rect captureRegion, const Clock& clock)
+	: clock(clock)
+{
+	referenceWindow = nullptr;
+	this->captureRegion = captureRegion;
+	Initialise();
+}
+
+void DesktopFrameSource::Initialise()
+{
+	desktopWindow = GetDesktopWindow();
+	frameIndex = 0;
+
+	//The device contexts and bitmap live as long as the source so capturing a frame doesn't create any GDI objects
+	desktopDC = GetDC(desktopWindow);
+	compatibleDC = CreateCompatibleDC(desktopDC);
+	SetStretchBltMode(compatibleDC, COLORONCOLOR);
+
+	bitmap = nullptr;
+	bitmapWidth = 0;
+	bitmapHeight = 0;
+}
+
+DesktopFrameSource::~DesktopFrameSource()
+{
+	// avoid memory leak
+	if (bitmap != nullptr)
+	{
+		DeleteObject(bitmap);
+	}
+	DeleteDC(compatibleDC);
+	ReleaseDC(desktopWindow, desktopDC);
+}
+
+void DesktopFrameSource::ResizeBitmap(int width, int height)
+{
+	if (bitmap != nullptr)
+	{
+		DeleteObject(bitmap);
+	}
+
+	// create a bitmap
+	bitmap = CreateCompatibleBitmap(desktopDC, width, height);
+	bitmapWidth = width;
+	bitmapHeight = height;
+
+	// use the previously created device context with the bitmap
+	SelectObject(compatibleDC, bitmap);
+
+	bitmapInfo.biSize = sizeof(BITMAPINFOHEADER);    //http://msdn.microsoft.com/en-us/library/windows/window/dd183402%28v=vs.85%29.aspx
+	bitmapInfo.biWidth = width;
+	bitmapInfo.biHeight = -height;  //this is the line that makes it draw upside down or not
+	bitmapInfo.biPlanes = 1;
+	bitmapInfo.biBitCount = 32;
+	bitmapInfo.biCompression = BI_RGB;
+	bitmapInfo.biSizeImage = 0;
+	bitmapInfo.biXPelsPerMeter = 0;
+	bitmapInfo.biYPelsPerMeter = 0;
+	bitmapInfo.biClrUsed = 0;
+	bitmapInfo.biClrImportant = 0;
+}
+
+bool DesktopFrameSource::Grab(Frame& frame)
+{
+	int left = captureRegion.x;
+	int top = captureRegion.y;
+	int width = captureRegion.width;
+	int height = captureRegion.height;
+
+	//While the reference window is minimised or has no area left there is nothing to capture, so wait for it to
+	//come back rather than ending the capture. Only a window that no longer exists ends it.
+	while (referenceWindow != nullptr)
+	{
+		RECT windowRectangle;
+		if (!GetWindowRect(referenceWindow, &windowRectangle))
+		{
+			return false;
+		}
+
+		//Strip the window border and title bar so we only capture what is seen through the window
+		left = windowRectangle.left + 9;
+		top = windowRectangle.top + 32;
+		width = windowRectangle.right - windowRectangle.left - 9 - 8;
+		height = windowRectangle.bottom - windowRectangle.top - 32 - 8;
+
+		if (!IsIconic(referenceWindow) && width > 0 && height > 0)
+		{
+			break;
+		}
+
+		Sleep(EMPTY_WINDOW_RETRY_MILLISECONDS);
+	}
+
+	if (width != bitmapWidth || height != bitmapHeight)
+	{
+		ResizeBitmap(width, height);
+	}
+
+	//Only reallocates when the reference window has been resized
+	frame.image.create(height, width, CV_8UC4);
+
+	frame.time = clock.Now();
+	// copy from the window device context to the bitmap device context
+	StretchBlt(compatibleDC, 0, 0, width, height, desktopDC, left, top, width, height, SRCCOPY); //change SRCCOPY to NOTSRCCOPY for wacky colors !
+	GetDIBits(compatibleDC, bitmap, 0, height, frame.image.data, (BITMAPINFO *)&bitmapInfo, DIB_RGB_COLORS);  //copy from the compatible DC's bitmap into the frame
+
+	frame.index = frameIndex++;
+
+	return true;
+}
+
+#endif
+
+ReplayFrameSource::ReplayFrameSource(const std::string& path, const std::string& timestampPath, double framesPerSecond)
+{
+	nextImageFile = 0;
+	frameIndex = 0;
+	this->framesPerSecond = framesPerSecond;
+
+	if (!timestampPath.empty())
+	{
+		std::ifstream timestampFile(timestampPath);
+		double milliseconds;
+		while (timestampFile >> milliseconds)
+		{
+			recordedMilliseconds.push_back(milliseconds);
+		}
+	}
+
+	//Video files and printf-style image sequences go through VideoCapture, anything else is treated as a directory or glob
+	if (!capture.open(path))
+	{
+		cv::glob(path, imageFiles, false);
+		std::sort(imageFiles.begin(), imageFiles.end());
+	}
+}
+
+bool ReplayFrameSource::IsOpen() const
+{
+	return capture.isOpened() || !imageFiles.empty();
+}
+
+bool ReplayFrameSource::ReadNext(cv::Mat& image)
+{
+	if (capture.isOpened())
+	{
+		return capture.read(image);
+	}
+
+	//Skip anything in the directory that isn't an image
+	while (nextImageFile < imageFiles.size())
+	{
+		image = cv::imread(imageFiles[nextImageFile++], cv::IMREAD_COLOR);
+		if (!image.empty())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+double ReplayFrameSource::GetFrameMilliseconds() const
+{
+	if (frameIndex < (int)recordedMilliseconds.size())
+	{
+		return recordedMilliseconds[frameIndex];
+	}
+
+	if (capture.isOpened())
+	{
+		//Position of the frame that was just read
+		double videoMilliseconds = capture.get(cv::CAP_PROP_POS_MSEC);
+		if (videoMilliseconds > 0 || frameIndex == 0)
+		{
+			return videoMilliseconds;
+		}
+	}
+
+	return frameIndex * 1000.0 / framesPerSecond;
+}
+
+bool ReplayFrameSource::Grab(Frame& frame)
+{
+	if (!ReadNext(decodedImage) || decodedImage.empty())
+	{
+		return false;
+	}
+
+	//Match the BGRA layout of the desktop capture so the rest of the pipeline sees one format.
+	//Converting into the frame's existing buffer avoids an allocation per frame once the size is known.
+	cv::cvtColor(decodedImage, frame.image, cv::COLOR_BGR2BGRA);
+	frame.time = TimestampFromMilliseconds(GetFrameMilliseconds());
+	frame.index = frameIndex++;
+
+	return true;
+}
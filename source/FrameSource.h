@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/videoio/videoio.hpp>
+
+#ifdef _WIN32
+	#include <Windows.h>
+#endif
+
+#include "Clock.h"
+
+//A single captured image as handed to the tracker
+struct Frame
+{
+	cv::Mat image;
+	int index;
+	//when the image was captured, either stamped live or taken from the recording
+	Timestamp time;
+
+	Frame()
+	{
+		index = -1;
+	}
+};
+
+//Anything the tracker can pull frames from. Every backend hands out CV_8UC4 (BGRA) images.
+class FrameSource
+{
+public:
+	virtual ~FrameSource() {}
+
+	//Fills frame with the next image, returns false once the source is exhausted
+	virtual bool Grab(Frame& frame) = 0;
+
+	//Live sources are paced by the outside world, replay sources run as fast as they are pulled
+	virtual bool IsLive() const = 0;
+};
+
+#ifdef _WIN32
+//Captures the desktop area underneath the click-through reference window, or a fixed area of the desktop
+class DesktopFrameSource : public FrameSource
+{
+public:
+	DesktopFrameSource(HWND referenceWindow, const Clock& clock);
+	DesktopFrameSource(cv::Rect captureRegion, const Clock& clock);
+	~DesktopFrameSource();
+
+	bool Grab(Frame& frame) override;
+	bool IsLive() const override { return true; }
+
+private:
+	void Initialise();
+	void ResizeBitmap(int width, int height);
+
+	//null when capturing a fixed region
+	HWND referenceWindow;
+	cv::Rect captureRegion;
+	HWND desktopWindow;
+	const Clock& clock;
+	int frameIndex;
+
+	HDC desktopDC;
+	HDC compatibleDC;
+	HBITMAP bitmap;
+	BITMAPINFOHEADER bitmapInfo;
+	int bitmapWidth;
+	int bitmapHeight;
+};
+#endif
+
+//Replays a recorded session from a video file, an image sequence pattern (e.g. "spin_%04d.png")
+//or a directory of images, without any throttling.
+//Frame times come from the optional timestamp file (one capture time in milliseconds per line),
+//otherwise from the video's own timestamps, otherwise from the frame index at framesPerSecond.
+class ReplayFrameSource : public FrameSource
+{
+public:
+	ReplayFrameSource(const std::string& path, const std::string& timestampPath, double framesPerSecond);
+
+	bool IsOpen() const;
+
+	bool Grab(Frame& frame) override;
+	bool IsLive() const override { return false; }
+
+private:
+	bool ReadNext(cv::Mat& image);
+	double GetFrameMilliseconds() const;
+
+	cv::VideoCapture capture;
+	std::vector<cv::String> imageFiles;
+	size_t nextImageFile;
+	cv::Mat decodedImage;
+	std::vector<double> recordedMilliseconds;
+	double framesPerSecond;
+	int frameIndex;
+};
@@ -0,0 +1,247 @@
+#include "LandingDistribution.h"
+
+#include <algorithm>
+#include <cmath>
+
+//Trajectories drawn by one chunk. Small enough that a full set of chunks keeps every thread busy,
+//big enough that the per-chunk setup doesn't matter.
+const static int CHUNK_SAMPLES = 256;
+
+//Lower triangle L with L L^T = covariance. Falls back to the standard deviations alone if rounding has left the
+//covariance not quite positive definite.
+static void Cholesky(const double covariance[3][3], double lower[3][3])
+{
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			lower[row][column] = 0;
+		}
+	}
+
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column <= row; column++)
+		{
+			double sum = covariance[row][column];
+			for (int k = 0; k < column; k++)
+			{
+				sum -= lower[row][k] * lower[column][k];
+			}
+
+			if (row == column)
+			{
+				if (sum <= 0)
+				{
+					for (int i = 0; i < 3; i++)
+					{
+						for (int j = 0; j < 3; j++)
+						{
+							lower[i][j] = i == j ? std::sqrt(std::max(covariance[i][i], 0.0)) : 0;
+						}
+					}
+					return;
+				}
+				lower[row][row] = std::sqrt(sum);
+			}
+			else
+			{
+				lower[row][column] = sum / lower[column][column];
+			}
+		}
+	}
+}
+
+//Draws the trajectories of a range of chunks
+class LandingDistribution::SampleChunks : public cv::ParallelLoopBody
+{
+public:
+	const PocketPredictor* predictor;
+	int pocketCount;
+	int sampleCount;
+	std::chrono::steady_clock::time_point deadline;
+	uint64 seed;
+	int deflectorCount;
+
+	//ball state at its latest sighting and the square root of its covariance
+	double state[3];
+	double lower[3][3];
+	//seconds from the latest sighting, and from when the 0 was seen, until now
+	double ballSeconds;
+	double zeroSeconds;
+
+	double zeroAngle;
+	double zeroAngleError;
+	double rotorVelocity;
+	double rotorVelocityError;
+
+	int* chunkCounts;
+	int* chunkSamples;
+
+	void operator()(const cv::Range& range) const override
+	{
+		for (int chunk = range.start; chunk < range.end; chunk++)
+		{
+			int* counts = chunkCounts + chunk * pocketCount;
+			std::fill(counts, counts + pocketCount, 0);
+			chunkSamples[chunk] = 0;
+
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				continue;
+			}
+
+			cv::RNG random(seed + chunk);
+			int samples = std::min(CHUNK_SAMPLES, sampleCount - chunk * CHUNK_SAMPLES);
+			for (int sample = 0; sample < samples; sample++)
+			{
+				//Ball state drawn around the fit and carried forward to now
+				double noise[3] = { random.gaussian(1.0), random.gaussian(1.0), random.gaussian(1.0) };
+				double angle = state[0] + lower[0][0] * noise[0];
+				double velocity = state[1] + lower[1][0] * noise[0] + lower[1][1] * noise[1];
+				double acceleration = state[2] + lower[2][0] * noise[0] + lower[2][1] * noise[1] + lower[2][2] * noise[2];
+				angle += velocity * ballSeconds + acceleration * ballSeconds * ballSeconds / 2;
+				velocity += acceleration * ballSeconds;
+
+				double direction = velocity < 0 ? -1.0 : 1.0;
+				double secondsToLeave, secondsToLand, travel;
+				if (!predictor->Project(std::fabs(velocity), -direction * acceleration, secondsToLeave, secondsToLand, travel))
+				{
+					continue;
+				}
+
+				//Carried on by the deflectors anywhere up to the next one
+				if (deflectorCount > 0)
+				{
+					travel += random.uniform(0.0, 360.0 / deflectorCount);
+				}
+				double landingAngle = angle + direction * travel;
+
+				double sampledRotorVelocity = rotorVelocity + rotorVelocityError * random.gaussian(1.0);
+				double zeroLandingAngle = zeroAngle + zeroAngleError * random.gaussian(1.0) + sampledRotorVelocity * (zeroSeconds + secondsToLand);
+
+				counts[predictor->GetPocketIndex(landingAngle, zeroLandingAngle)]++;
+			}
+			chunkSamples[chunk] = samples;
+		}
+	}
+};
+
+LandingDistribution::LandingDistribution(const PocketPredictor& predictor)
+	: predictor(predictor)
+{
+	sampleCount = 4096;
+	timeBudget = 0.005;
+	deflectorCount = 8;
+	zeroAngleError = 1.f;
+
+	probabilities.assign(predictor.GetPocketCount(), 0.f);
+	samplesDrawn = 0;
+	seed = 0x2545F4914F6CDD1DULL;
+}
+
+bool LandingDistribution::Estimate(Timestamp now, const AngularMotionFit& ball, float zeroAngle, Timestamp zeroTime, float rotorVelocity, float rotorVelocityVariance)
+{
+	std::fill(probabilities.begin(), probabilities.end(), 0.f);
+	samplesDrawn = 0;
+
+	if (!ball.IsValid() || sampleCount <= 0)
+	{
+		return false;
+	}
+
+	int pocketCount = predictor.GetPocketCount();
+	int chunks = (sampleCount + CHUNK_SAMPLES - 1) / CHUNK_SAMPLES;
+	//Only grows when the sample count is raised
+	chunkCounts.resize(chunks * pocketCount);
+	chunkSamples.resize(chunks);
+
+	SampleChunks body;
+	body.predictor = &predictor;
+	body.pocketCount = pocketCount;
+	body.sampleCount = sampleCount;
+	body.deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeBudget));
+	body.seed = seed;
+	body.deflectorCount = deflectorCount;
+
+	double covariance[3][3];
+	ball.GetCovariance(covariance);
+	Cholesky(covariance, body.lower);
+	for (int i = 0; i < 3; i++)
+	{
+		body.state[i] = ball.GetState()[i];
+	}
+	body.ballSeconds = std::chrono::duration<double>(now - ball.GetLastTime()).count();
+	body.zeroSeconds = std::chrono::duration<double>(now - zeroTime).count();
+
+	body.zeroAngle = zeroAngle;
+	body.zeroAngleError = zeroAngleError;
+	body.rotorVelocity = rotorVelocity;
+	body.rotorVelocityError = std::sqrt(std::max(rotorVelocityVariance, 0.f));
+
+	body.chunkCounts = chunkCounts.data();
+	body.chunkSamples = chunkSamples.data();
+
+	cv::parallel_for_(cv::Range(0, chunks), body);
+	seed += chunks;
+
+	//Summed in chunk order, so the same seed always gives the same histogram
+	int landed = 0;
+	for (int chunk = 0; chunk < chunks; chunk++)
+	{
+		samplesDrawn += chunkSamples[chunk];
+		const int* counts = &chunkCounts[chunk * pocketCount];
+		for (int index = 0; index < pocketCount; index++)
+		{
+			probabilities[index] += (float)counts[index];
+			landed += counts[index];
+		}
+	}
+
+	if (landed == 0)
+	{
+		return false;
+	}
+
+	for (int index = 0; index < pocketCount; index++)
+	{
+		probabilities[index] /= landed;
+	}
+
+	return true;
+}
+
+int GetMostLikelyPockets(const std::vector<float>& probabilities, const int* pocketOrder, PocketChance* likely, int count)
+{
+	int filled = 0;
+	for (int index = 0; index < (int)probabilities.size(); index++)
+	{
+		if (probabilities[index] <= 0)
+		{
+			continue;
+		}
+
+		//Insertion into the short sorted list
+		int position = std::min(filled, count);
+		while (position > 0 && likely[position - 1].probability < probabilities[index])
+		{
+			if (position < count)
+			{
+				likely[position] = likely[position - 1];
+			}
+			position--;
+		}
+		if (position < count)
+		{
+			likely[position].pocket = pocketOrder[index];
+			likely[position].probability = probabilities[index];
+			filled = std::min(filled + 1, count);
+		}
+	}
+	return filled;
+}
+
+int LandingDistribution::GetMostLikely(PocketChance* likely, int count) const
+{
+	return GetMostLikelyPockets(probabilities, predictor.GetPocketOrder(), likely, count);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AngularMotionFit.h"
+#include "Clock.h"
+#include "PocketPredictor.h"
+
+//One pocket and how likely the ball is to land in it
+struct PocketChance
+{
+	int pocket;
+	float probability;
+
+	PocketChance()
+	{
+		pocket = -1;
+		probability = 0;
+	}
+};
+
+//Fills likely with up to count of the pockets with the highest probabilities (indexed by position in pocketOrder),
+//most likely first. Returns how many it filled.
+int GetMostLikelyPockets(const std::vector<float>& probabilities, const int* pocketOrder, PocketChance* likely, int count);
+
+//How sure a PocketPredictor prediction is. Draws trajectories with the ball's angle, speed and deceleration taken
+//from the fit's covariance, the rotor speed and the 0's position from their own uncertainties, and the ball
+//scattered by the deflectors as in resources/roulette_paper.pdf (uniformly over the gap between two of them),
+//and counts which pocket each lands in. The samples are split into chunks that are drawn in parallel, each with its
+//own random sequence and counts, so the result doesn't depend on how the chunks were shared out between threads.
+class LandingDistribution
+{
+public:
+	explicit LandingDistribution(const PocketPredictor& predictor);
+
+	//Trajectories drawn for each estimate
+	int sampleCount;
+	//Seconds an estimate may take. Chunks not started by then are left out and the rest still make the histogram.
+	double timeBudget;
+	//Deflectors round the stator, 0 to leave out the scatter
+	int deflectorCount;
+	//Standard deviation of the 0's angle when it was seen, in degrees
+	float zeroAngleError;
+
+	//Same arguments as PocketPredictor::Predict, with the variance of rotorVelocity.
+	//Returns false if none of the trajectories landed.
+	bool Estimate(Timestamp now, const AngularMotionFit& ball, float zeroAngle, Timestamp zeroTime, float rotorVelocity, float rotorVelocityVariance);
+
+	//Share of the landed trajectories ending in each pocket, by position in the pocket order
+	const std::vector<float>& GetProbabilities() const { return probabilities; }
+
+	//Trajectories that were drawn before the time ran out, landed or not
+	int GetSamplesDrawn() const { return samplesDrawn; }
+
+	//Fills likely with up to count of the most likely pockets, most likely first. Returns how many it filled.
+	int GetMostLikely(PocketChance* likely, int count) const;
+
+private:
+	class SampleChunks;
+
+	const PocketPredictor& predictor;
+
+	//pocket counts of each chunk one after another, and how many trajectories each chunk drew
+	std::vector<int> chunkCounts;
+	std::vector<int> chunkSamples;
+	std::vector<float> probabilities;
+	int samplesDrawn;
+	//moved on every estimate so successive estimates don't draw the same trajectories
+	uint64 seed;
+};
@@ -0,0 +1,94 @@
+#include "LapTable.h"
+
+#include <algorithm>
+
+#include "PolarTable.h"
+
+void LapTable::Clear()
+{
+	angles.clear();
+	radii.clear();
+	times.clear();
+}
+
+void LapTable::Build(const TrackStore& lap)
+{
+	int count = lap.Size();
+
+	order.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+
+	//stable so points at the same angle stay in the order they were seen
+	const std::vector<float>& lapAngles = lap.angle;
+	std::stable_sort(order.begin(), order.end(), [&lapAngles](int a, int b) { return lapAngles[a] < lapAngles[b]; });
+
+	angles.resize(count);
+	radii.resize(count);
+	times.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		angles[i] = lap.angle[order[i]];
+		radii[i] = lap.radius[order[i]];
+		times[i] = lap.time[order[i]];
+	}
+}
+
+void LapTable::FindNeighbours(float angle, float resetAngle, int& negativeIndex, float& negativeDistance, int& positiveIndex, float& positiveDistance) const
+{
+	negativeIndex = -1;
+	negativeDistance = -360.f;
+	positiveIndex = -1;
+	positiveDistance = 360.f;
+
+	//Nothing past the reset point belongs to the lap
+	float distanceToReset = GetAngleDifference(angle, resetAngle);
+	if (distanceToReset > 0)
+	{
+		positiveDistance = distanceToReset;
+	}
+	else
+	{
+		negativeDistance = distanceToReset;
+	}
+
+	if (angles.empty())
+	{
+		return;
+	}
+
+	int count = (int)angles.size();
+
+	//First entry at or after the angle, wrapping round past 360
+	int positive = (int)(std::lower_bound(angles.begin(), angles.end(), angle) - angles.begin());
+	if (positive == count)
+	{
+		positive = 0;
+	}
+
+	float distance = GetAngleDifference(angle, angles[positive]);
+	if (distance >= 0 && distance < positiveDistance)
+	{
+		positiveDistance = distance;
+		positiveIndex = positive;
+	}
+
+	//Last entry at or before the angle, wrapping round past 0
+	int negative = (int)(std::upper_bound(angles.begin(), angles.end(), angle) - angles.begin()) - 1;
+	if (negative < 0)
+	{
+		negative = count - 1;
+	}
+
+	//Of several entries at the same angle, the first one seen
+	negative = (int)(std::lower_bound(angles.begin(), angles.begin() + negative, angles[negative]) - angles.begin());
+
+	distance = GetAngleDifference(angle, angles[negative]);
+	if (distance <= 0 && distance > negativeDistance)
+	{
+		negativeDistance = distance;
+		negativeIndex = negative;
+	}
+}
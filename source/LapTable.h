@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "Clock.h"
+#include "TrackStore.h"
+
+//The points of a finished lap sorted by angle, so the lap points either side of any angle are found
+//with a binary search instead of a scan over the whole lap
+class LapTable
+{
+public:
+	void Clear();
+	//Replaces the contents with the points of lap
+	void Build(const TrackStore& lap);
+
+	bool IsEmpty() const { return angles.empty(); }
+	float GetRadius(int index) const { return radii[index]; }
+	Timestamp GetTime(int index) const { return times[index]; }
+
+	//Finds the nearest entries at or after angle (positive) and at or before it (negative), as measured with
+	//GetAngleDifference. The reset angle, where the lap starts and ends, bounds the search in both directions.
+	//An index is -1 if there's no entry on that side, in which case its distance is the bound that was used.
+	void FindNeighbours(float angle, float resetAngle, int& negativeIndex, float& negativeDistance, int& positiveIndex, float& positiveDistance) const;
+
+private:
+	//sorted by angle, points at the same angle in the order they were seen
+	std::vector<float> angles;
+	std::vector<float> radii;
+	std::vector<Timestamp> times;
+	//scratch for the sort
+	std::vector<int> order;
+};
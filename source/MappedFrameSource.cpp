@@ -0,0 +1,236 @@
+#include "MappedFrameSource.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "FrameRecording.h"
+
+//Whether the chunk at offset is whole and its header describes an image that fits inside it, so a damaged
+//recording can never give a frame that reads past its chunk
+static bool ReadChunkHeader(const unsigned char* data, uint64_t size, uint64_t offset, FrameChunkHeader& header)
+{
+	if (offset < RECORDING_ALIGNMENT || offset + FRAME_DATA_OFFSET > size)
+	{
+		return false;
+	}
+
+	memcpy(&header, data + offset, sizeof(header));
+	if (memcmp(header.magic, FRAME_CHUNK_MAGIC, sizeof(header.magic)) != 0 || header.width <= 0 || header.height <= 0
+		|| header.type < 0 || header.type != CV_MAT_TYPE(header.type))
+	{
+		return false;
+	}
+
+	//Every row has to hold the pixels, and all the rows have to fit in the file (which also keeps the sizes from overflowing)
+	if (header.step < (int64_t)header.width * CV_ELEM_SIZE(header.type) || (uint64_t)header.step > size / (uint64_t)header.height)
+	{
+		return false;
+	}
+
+	return offset + GetFrameChunkSize(header.step, header.height) <= size;
+}
+
+MappedFrameSource::MappedFrameSource(const std::string& path)
+{
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = nullptr;
+#else
+	file = -1;
+#endif
+	data = nullptr;
+	size = 0;
+	nextFrame = 0;
+
+	if (Map(path))
+	{
+		ReadIndex();
+	}
+}
+
+MappedFrameSource::~MappedFrameSource()
+{
+	Unmap();
+}
+
+bool MappedFrameSource::IsRecording(const std::string& path)
+{
+	std::ifstream recording(path, std::ios::binary);
+	RecordingHeader header;
+	return recording.read((char*)&header, sizeof(header)) && memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) == 0;
+}
+
+bool MappedFrameSource::Map(const std::string& path)
+{
+	void* view = nullptr;
+
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Unmap();
+		return false;
+	}
+	size = (uint64_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping != nullptr)
+	{
+		view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	}
+#else
+	file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		Unmap();
+		return false;
+	}
+	size = (uint64_t)status.st_size;
+
+	view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		view = nullptr;
+	}
+#endif
+
+	data = (unsigned char*)view;
+	if (data == nullptr)
+	{
+		Unmap();
+		return false;
+	}
+
+	RecordingHeader header;
+	if (size < RECORDING_ALIGNMENT || (memcpy(&header, data, sizeof(header)), memcmp(header.magic, RECORDING_MAGIC, sizeof(header.magic)) != 0)
+		|| header.version != RECORDING_VERSION || header.alignment != RECORDING_ALIGNMENT)
+	{
+		Unmap();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFrameSource::Unmap()
+{
+#ifdef _WIN32
+	if (data != nullptr)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mapping != nullptr)
+	{
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (data != nullptr)
+	{
+		munmap(data, size);
+	}
+	if (file >= 0)
+	{
+		close(file);
+		file = -1;
+	}
+#endif
+	data = nullptr;
+	size = 0;
+	chunkOffsets.clear();
+}
+
+void MappedFrameSource::ReadIndex()
+{
+	chunkOffsets.clear();
+
+	RecordingFooter footer;
+	if (size >= RECORDING_ALIGNMENT + sizeof(footer))
+	{
+		memcpy(&footer, data + size - sizeof(footer), sizeof(footer));
+		//The index has to lie between the first chunk and the footer, checked before subtracting so a damaged offset can't wrap around
+		uint64_t indexEnd = size - sizeof(footer);
+		bool indexed = memcmp(footer.magic, RECORDING_INDEX_MAGIC, sizeof(footer.magic)) == 0
+			&& footer.indexOffset >= RECORDING_ALIGNMENT && footer.indexOffset <= indexEnd
+			&& footer.frameCount <= (indexEnd - footer.indexOffset) / sizeof(uint64_t);
+		if (indexed)
+		{
+			chunkOffsets.resize(footer.frameCount);
+			memcpy(chunkOffsets.data(), data + footer.indexOffset, footer.frameCount * sizeof(uint64_t));
+			return;
+		}
+	}
+
+	//No index, so walk the chunks. Each one says how big it is, and the walk stops at the first that doesn't fit.
+	uint64_t offset = RECORDING_ALIGNMENT;
+	FrameChunkHeader header;
+	while (ReadChunkHeader(data, size, offset, header))
+	{
+		chunkOffsets.push_back(offset);
+		offset += GetFrameChunkSize(header.step, header.height);
+	}
+}
+
+void MappedFrameSource::Seek(int index)
+{
+	nextFrame = std::max(0, std::min(index, GetFrameCount()));
+}
+
+bool MappedFrameSource::GetFrame(int index, Frame& frame) const
+{
+	if (index < 0 || index >= GetFrameCount())
+	{
+		return false;
+	}
+
+	//Offsets from an index are checked like the chunks they point at
+	uint64_t offset = chunkOffsets[index];
+	FrameChunkHeader header;
+	if (!ReadChunkHeader(data, size, offset, header))
+	{
+		return false;
+	}
+
+	//A view of the mapping, any buffer the frame had before is let go
+	frame.image = cv::Mat(header.height, header.width, header.type, data + offset + FRAME_DATA_OFFSET, (size_t)header.step);
+	frame.time = TimestampFromMilliseconds(header.microseconds / 1000.0);
+	frame.index = index;
+
+	return true;
+}
+
+bool MappedFrameSource::Grab(Frame& frame)
+{
+	if (!GetFrame(nextFrame, frame))
+	{
+		return false;
+	}
+
+	nextFrame++;
+	return true;
+}
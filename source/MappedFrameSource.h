@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FrameSource.h"
+
+//Replays a raw frame recording made with --record (FrameRecording.h) by mapping the whole file into memory.
+//Frames are handed out as views of the mapping, so nothing is decoded or copied, and any frame can be reached
+//straight away through the recording's index, for scrubbing or for several threads each taking their own frames.
+//The mapping is copy-on-write, so anything drawn onto a frame stays in this process and never reaches the file.
+class MappedFrameSource : public FrameSource
+{
+public:
+	explicit MappedFrameSource(const std::string& path);
+	~MappedFrameSource();
+
+	//Whether path starts like a raw frame recording
+	static bool IsRecording(const std::string& path);
+
+	bool IsOpen() const { return data != nullptr; }
+
+	int GetFrameCount() const { return (int)chunkOffsets.size(); }
+
+	//The next Grab returns frame index
+	void Seek(int index);
+
+	bool Grab(Frame& frame) override;
+	bool IsLive() const override { return false; }
+
+	//Any frame by its position in the recording. Doesn't move the replay on, so it is safe from several threads
+	//at once. The image is only valid while the source is.
+	bool GetFrame(int index, Frame& frame) const;
+
+private:
+	bool Map(const std::string& path);
+	void Unmap();
+	//From the index at the end of the file, or by walking the chunks if the recording was never closed
+	void ReadIndex();
+
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+	unsigned char* data;
+	uint64_t size;
+
+	std::vector<uint64_t> chunkOffsets;
+	int nextFrame;
+};
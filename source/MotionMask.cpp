@@ -0,0 +1,374 @@
+#include "MotionMask.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+cv::Mat GetScratchArea(cv::Mat& buffer, cv::Size size, int type)
+{
+	if (buffer.type() != type || buffer.cols < size.width || buffer.rows < size.height)
+	{
+		buffer.create(std::max(buffer.rows, size.height), std::max(buffer.cols, size.width), type);
+	}
+
+	return buffer(cv::Rect(cv::Point(0, 0), size));
+}
+
+BoxThreshold::BoxThreshold()
+{
+	preparedBoxSize = 0;
+	preparedSensitivity = -1;
+	minimumCount = 0;
+	addedRows = 0;
+	finishedRows = 0;
+}
+
+void BoxThreshold::Prepare(cv::Size size, int boxSize, int sensitivity)
+{
+	if (size == preparedSize && boxSize == preparedBoxSize && sensitivity == preparedSensitivity)
+	{
+		return;
+	}
+
+	preparedSize = size;
+	preparedBoxSize = boxSize;
+	preparedSensitivity = sensitivity;
+
+	//cv::blur puts the anchor at the centre, which for even sizes is one pixel past the middle
+	int anchor = boxSize / 2;
+
+	columnIndices.resize(size.width + boxSize - 1);
+	for (int i = 0; i < (int)columnIndices.size(); i++)
+	{
+		columnIndices[i] = cv::borderInterpolate(i - anchor, size.width, cv::BORDER_REFLECT_101);
+	}
+
+	rowIndices.resize(size.height + boxSize - 1);
+	for (int i = 0; i < (int)rowIndices.size(); i++)
+	{
+		rowIndices[i] = cv::borderInterpolate(i - anchor, size.height, cv::BORDER_REFLECT_101);
+	}
+
+	lastRowNeeded.resize(size.height);
+	for (int y = 0; y < size.height; y++)
+	{
+		lastRowNeeded[y] = *std::max_element(rowIndices.begin() + y, rowIndices.begin() + y + boxSize);
+	}
+
+	rowCounts = GetScratchArea(rowCountsBuffer, size, CV_8UC1);
+	columnCounts.resize(size.width);
+
+	//The blur of a 0/255 image only depends on how many pixels in the box are set
+	int area = boxSize * boxSize;
+	minimumCount = area + 1;
+	for (int count = 0; count <= area; count++)
+	{
+		if (cv::saturate_cast<uchar>(255.0 * count / area) > sensitivity)
+		{
+			minimumCount = count;
+			break;
+		}
+	}
+}
+
+void BoxThreshold::Apply(const cv::Mat& binaryImage, cv::Mat& thresholdImage, int boxSize, int sensitivity)
+{
+	CV_Assert(binaryImage.type() == CV_8UC1);
+
+	//An output row is only written once its input row has been counted, so the output can safely overwrite the input
+	Begin(binaryImage.size(), boxSize, sensitivity, thresholdImage);
+	for (int y = 0; y < binaryImage.rows; y++)
+	{
+		AddRow(binaryImage.ptr<uchar>(y));
+	}
+}
+
+void BoxThreshold::Begin(cv::Size size, int boxSize, int sensitivity, cv::Mat& thresholdImage)
+{
+	CV_Assert(boxSize > 0 && boxSize <= 255);
+
+	Prepare(size, boxSize, sensitivity);
+
+	thresholdImage.create(size, CV_8UC1);
+	//shares thresholdImage's data
+	outputImage = thresholdImage;
+	addedRows = 0;
+	finishedRows = 0;
+}
+
+void BoxThreshold::AddRow(const uchar* binaryRow)
+{
+	CV_Assert(addedRows < preparedSize.height);
+
+	int cols = preparedSize.width;
+	int boxSize = preparedBoxSize;
+
+	//Count the set pixels in the window around each pixel of the row
+	uchar* counts = rowCounts.ptr<uchar>(addedRows++);
+
+	int count = 0;
+	for (int i = 0; i < boxSize; i++)
+	{
+		count += binaryRow[columnIndices[i]] != 0;
+	}
+	counts[0] = (uchar)count;
+
+	for (int x = 1; x < cols; x++)
+	{
+		count += (binaryRow[columnIndices[x + boxSize - 1]] != 0) - (binaryRow[columnIndices[x - 1]] != 0);
+		counts[x] = (uchar)count;
+	}
+
+	//Then finish every output row whose box is now fully counted
+	while (finishedRows < preparedSize.height && lastRowNeeded[finishedRows] < addedRows)
+	{
+		FinishRow(finishedRows++);
+	}
+}
+
+void BoxThreshold::FinishRow(int y)
+{
+	int cols = preparedSize.width;
+	int boxSize = preparedBoxSize;
+
+	//Slide the box down the image, adding the row entering it and removing the row leaving it
+	if (y == 0)
+	{
+		std::fill(columnCounts.begin(), columnCounts.end(), 0);
+		for (int i = 0; i < boxSize; i++)
+		{
+			const uchar* counts = rowCounts.ptr<uchar>(rowIndices[i]);
+			for (int x = 0; x < cols; x++)
+			{
+				columnCounts[x] += counts[x];
+			}
+		}
+	}
+	else
+	{
+		const uchar* entering = rowCounts.ptr<uchar>(rowIndices[y + boxSize - 1]);
+		const uchar* leaving = rowCounts.ptr<uchar>(rowIndices[y - 1]);
+		for (int x = 0; x < cols; x++)
+		{
+			columnCounts[x] += entering[x] - leaving[x];
+		}
+	}
+
+	uchar* destination = outputImage.ptr<uchar>(y);
+	for (int x = 0; x < cols; x++)
+	{
+		destination[x] = columnCounts[x] >= minimumCount ? 255 : 0;
+	}
+}
+
+FusedMotionMask::FusedMotionMask()
+{
+	clearedLuma = nullptr;
+	clearedVersion = 0;
+	lumaShift = 0;
+	blueWeight = 0;
+	greenWeight = 0;
+	redWeight = 0;
+	exact = false;
+}
+
+void FusedMotionMask::Calibrate()
+{
+	//OpenCV 3.2 rounds BGR2GRAY with 14 bit weights, newer versions switched to 15 bit ones.
+	//Find out which one this build uses by converting some noise and checking every pixel.
+	const int candidates[2][4] = { { 14, 1868, 9617, 4899 }, { 15, 3735, 19235, 9798 } };
+
+	cv::Mat noise(32, 64, CV_8UC4);
+	cv::RNG rng(0x5eed);
+	rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+
+	cv::Mat gray;
+	cv::cvtColor(noise, gray, cv::COLOR_BGR2GRAY);
+
+	for (int c = 0; c < 2 && !exact; c++)
+	{
+		lumaShift = candidates[c][0];
+		blueWeight = candidates[c][1];
+		greenWeight = candidates[c][2];
+		redWeight = candidates[c][3];
+
+		exact = true;
+		for (int y = 0; y < noise.rows && exact; y++)
+		{
+			const uchar* bgra = noise.ptr<uchar>(y);
+			const uchar* expected = gray.ptr<uchar>(y);
+			for (int x = 0; x < noise.cols; x++, bgra += 4)
+			{
+				int luma = (bgra[0] * blueWeight + bgra[1] * greenWeight + bgra[2] * redWeight + (1 << (lumaShift - 1))) >> lumaShift;
+				if (luma != expected[x])
+				{
+					exact = false;
+					break;
+				}
+			}
+		}
+	}
+}
+
+bool FusedMotionMask::IsExact()
+{
+	if (lumaShift == 0)
+	{
+		Calibrate();
+	}
+
+	return exact;
+}
+
+void FusedMotionMask::ProcessPixels(const uchar* bgra, uchar* previousLuma, uchar* binary, int count, int sensitivity) const
+{
+	int x = 0;
+	int rounding = 1 << (lumaShift - 1);
+
+#if CV_SIMD128
+	//16 pixels at a time, with the luma sums done as pairs of 16 bit multiply-adds: (b, g).(bw, gw) + (r, 1).(rw, rounding)
+	cv::v_int16x8 blueGreenWeights(blueWeight, greenWeight, blueWeight, greenWeight, blueWeight, greenWeight, blueWeight, greenWeight);
+	cv::v_int16x8 redRoundingWeights(redWeight, rounding, redWeight, rounding, redWeight, rounding, redWeight, rounding);
+	cv::v_int16x8 ones = cv::v_setall_s16(1);
+	cv::v_uint8x16 threshold = cv::v_setall_u8((uchar)sensitivity);
+
+	for (; x <= count - 16; x += 16)
+	{
+		cv::v_uint8x16 b, g, r, a;
+		cv::v_load_deinterleave(bgra + x * 4, b, g, r, a);
+
+		cv::v_uint16x8 b0, b1, g0, g1, r0, r1;
+		cv::v_expand(b, b0, b1);
+		cv::v_expand(g, g0, g1);
+		cv::v_expand(r, r0, r1);
+
+		cv::v_int16x8 blueGreen0, blueGreen1, blueGreen2, blueGreen3;
+		cv::v_zip(cv::v_reinterpret_as_s16(b0), cv::v_reinterpret_as_s16(g0), blueGreen0, blueGreen1);
+		cv::v_zip(cv::v_reinterpret_as_s16(b1), cv::v_reinterpret_as_s16(g1), blueGreen2, blueGreen3);
+
+		cv::v_int16x8 redOne0, redOne1, redOne2, redOne3;
+		cv::v_zip(cv::v_reinterpret_as_s16(r0), ones, redOne0, redOne1);
+		cv::v_zip(cv::v_reinterpret_as_s16(r1), ones, redOne2, redOne3);
+
+		cv::v_int32x4 luma0 = (cv::v_dotprod(blueGreen0, blueGreenWeights) + cv::v_dotprod(redOne0, redRoundingWeights)) >> lumaShift;
+		cv::v_int32x4 luma1 = (cv::v_dotprod(blueGreen1, blueGreenWeights) + cv::v_dotprod(redOne1, redRoundingWeights)) >> lumaShift;
+		cv::v_int32x4 luma2 = (cv::v_dotprod(blueGreen2, blueGreenWeights) + cv::v_dotprod(redOne2, redRoundingWeights)) >> lumaShift;
+		cv::v_int32x4 luma3 = (cv::v_dotprod(blueGreen3, blueGreenWeights) + cv::v_dotprod(redOne3, redRoundingWeights)) >> lumaShift;
+
+		cv::v_uint8x16 luma = cv::v_pack_u(cv::v_pack(luma0, luma1), cv::v_pack(luma2, luma3));
+
+		if (binary != nullptr)
+		{
+			cv::v_store(binary + x, cv::v_absdiff(luma, cv::v_load(previousLuma + x)) > threshold);
+		}
+		cv::v_store(previousLuma + x, luma);
+	}
+#endif
+
+	for (; x < count; x++)
+	{
+		const uchar* pixel = bgra + x * 4;
+		int luma = (pixel[0] * blueWeight + pixel[1] * greenWeight + pixel[2] * redWeight + rounding) >> lumaShift;
+
+		if (binary != nullptr)
+		{
+			binary[x] = std::abs(luma - previousLuma[x]) > sensitivity ? 255 : 0;
+		}
+		previousLuma[x] = (uchar)luma;
+	}
+}
+
+bool FusedMotionMask::Apply(const cv::Mat& frame, cv::Mat& previousLuma, cv::Mat& motionMask, const AnnulusSpans& track, cv::Point origin, int sensitivity, int boxSize, int boxSensitivity)
+{
+	CV_Assert(frame.type() == CV_8UC4);
+	CV_Assert(track.Covers(origin, frame.size()));
+
+	IsExact();
+
+	int rows = frame.rows;
+	int cols = frame.cols;
+
+	//Without a previous frame there is nothing to compare with, just keep the luma for next time
+	bool hasPrevious = previousLuma.type() == CV_8UC1 && previousLuma.size() == frame.size();
+	if (!hasPrevious)
+	{
+		ComputeLuma(frame, previousLuma, track, origin);
+		return false;
+	}
+
+	//previousLuma is already 0 off the track unless the track has changed since it was zeroed. Pixels that have just
+	//come onto the track then compare against 0, like they would against an image masked with the old track, and
+	//pixels that have just left it compare their old luma against 0 before it is cleared.
+	bool clearGaps = previousLuma.data != clearedLuma || track.GetVersion() != clearedVersion || origin != clearedOrigin;
+	auto fillGap = [&](uchar* luma, uchar* binary, int begin, int end)
+	{
+		if (clearGaps)
+		{
+			for (int x = begin; x < end; x++)
+			{
+				binary[x] = luma[x] > sensitivity ? 255 : 0;
+				luma[x] = 0;
+			}
+		}
+		else
+		{
+			std::fill(binary + begin, binary + end, 0);
+		}
+	};
+
+	binaryRow.resize(cols);
+	boxThreshold.Begin(frame.size(), boxSize, boxSensitivity, motionMask);
+	for (int y = 0; y < rows; y++)
+	{
+		const uchar* bgra = frame.ptr<uchar>(y);
+		uchar* luma = previousLuma.ptr<uchar>(y);
+		uchar* binary = binaryRow.data();
+
+		int x = 0;
+		ForEachSpan(track, origin, y, cols, [&](int begin, int end)
+		{
+			fillGap(luma, binary, x, begin);
+			ProcessPixels(bgra + begin * 4, luma + begin, binary + begin, end - begin, sensitivity);
+			x = end;
+		});
+		fillGap(luma, binary, x, cols);
+
+		boxThreshold.AddRow(binary);
+	}
+
+	clearedLuma = previousLuma.data;
+	clearedVersion = track.GetVersion();
+	clearedOrigin = origin;
+
+	return true;
+}
+
+void FusedMotionMask::ComputeLuma(const cv::Mat& frame, cv::Mat& luma, const AnnulusSpans& track, cv::Point origin)
+{
+	CV_Assert(frame.type() == CV_8UC4);
+	CV_Assert(track.Covers(origin, frame.size()));
+
+	IsExact();
+
+	luma.create(frame.size(), CV_8UC1);
+	for (int y = 0; y < frame.rows; y++)
+	{
+		const uchar* bgra = frame.ptr<uchar>(y);
+		uchar* lumaRow = luma.ptr<uchar>(y);
+
+		int x = 0;
+		ForEachSpan(track, origin, y, frame.cols, [&](int begin, int end)
+		{
+			std::fill(lumaRow + x, lumaRow + begin, 0);
+			ProcessPixels(bgra + begin * 4, lumaRow + begin, nullptr, end - begin, 0);
+			x = end;
+		});
+		std::fill(lumaRow + x, lumaRow + frame.cols, 0);
+	}
+
+	clearedLuma = luma.data;
+	clearedVersion = track.GetVersion();
+	clearedOrigin = origin;
+}
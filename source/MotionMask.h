@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AnnulusSpans.h"
+
+//A size view of buffer, which is only ever grown, so work areas that change size from one frame to the next
+//(like search windows) don't reallocate every time
+cv::Mat GetScratchArea(cv::Mat& buffer, cv::Size size, int type);
+
+//Box blur followed by a binary threshold for images that only hold 0 and 255, as used to clean up the
+//frame difference masks. Gives the same result as cv::blur (BORDER_REFLECT_101) + cv::threshold(THRESH_BINARY),
+//but works on pixel counts in buffers that are kept between frames instead of building a filter every call.
+class BoxThreshold
+{
+public:
+	BoxThreshold();
+
+	//binaryImage and thresholdImage may be the same Mat
+	void Apply(const cv::Mat& binaryImage, cv::Mat& thresholdImage, int boxSize, int sensitivity);
+
+	//Row by row form of Apply for callers that produce the binary image one row at a time.
+	//Each row of thresholdImage is written as soon as all the rows its box covers have been added.
+	void Begin(cv::Size size, int boxSize, int sensitivity, cv::Mat& thresholdImage);
+	void AddRow(const uchar* binaryRow);
+
+private:
+	void Prepare(cv::Size size, int boxSize, int sensitivity);
+	void FinishRow(int y);
+
+	//number of set pixels in the horizontal window around each pixel, a view of rowCountsBuffer
+	cv::Mat rowCounts;
+	cv::Mat rowCountsBuffer;
+	//number of set pixels in the whole box around each pixel of the current row
+	std::vector<int> columnCounts;
+	//source column/row for each position of the border-extended image
+	std::vector<int> columnIndices;
+	std::vector<int> rowIndices;
+	//last source row that the box of each output row reaches, once reflected at the borders
+	std::vector<int> lastRowNeeded;
+
+	cv::Size preparedSize;
+	int preparedBoxSize;
+	int preparedSensitivity;
+	//smallest count whose blurred value is above the sensitivity
+	int minimumCount;
+
+	//output of the rows being added, and how far through it we are
+	cv::Mat outputImage;
+	int addedRows;
+	int finishedRows;
+};
+
+//The whole gray frame difference in one pass over the captured frame: BGRA to luma, the ball track mask,
+//the difference with the previous luma, the threshold, and the box blur + threshold done by BoxThreshold.
+//Gives the same motion mask as cvtColor(BGR2GRAY) + masking with the ball track + absdiff + threshold + blur + threshold,
+//without any of the intermediate images. Only the pixels on the track are converted and compared,
+//the luma and the difference are 0 everywhere else.
+class FusedMotionMask
+{
+public:
+	FusedMotionMask();
+
+	//False if cvtColor in the OpenCV we run against rounds the luma differently from the fixed point
+	//weights we know about. The result would then be close but not identical, so callers should keep
+	//using the OpenCV functions.
+	bool IsExact();
+
+	//Converts frame (CV_8UC4) to luma on the track, writes the motion mask between it and previousLuma,
+	//then stores it over previousLuma for the next frame. origin is where frame sits within the track's image.
+	//Returns false and leaves motionMask alone if previousLuma didn't hold a frame of the same size.
+	bool Apply(const cv::Mat& frame, cv::Mat& previousLuma, cv::Mat& motionMask, const AnnulusSpans& track, cv::Point origin, int sensitivity, int boxSize, int boxSensitivity);
+
+	//Just the masked luma of frame, e.g. to start comparing from a frame that wasn't processed
+	void ComputeLuma(const cv::Mat& frame, cv::Mat& luma, const AnnulusSpans& track, cv::Point origin);
+
+private:
+	void Calibrate();
+	//Converts count pixels to luma over previousLuma, and if binary isn't null marks the pixels that changed by more than sensitivity
+	void ProcessPixels(const uchar* bgra, uchar* previousLuma, uchar* binary, int count, int sensitivity) const;
+
+	//The luma buffer whose pixels off the track were last zeroed, and the track and origin it was zeroed for.
+	//As long as they stay the same those pixels are still 0 and don't need touching.
+	const uchar* clearedLuma;
+	int clearedVersion;
+	cv::Point clearedOrigin;
+
+	//one row of the thresholded difference, handed to the box stage as soon as it is done
+	std::vector<uchar> binaryRow;
+	BoxThreshold boxThreshold;
+
+	//fixed point luma weights matching cvtColor, 0 until calibrated
+	int lumaShift;
+	int blueWeight;
+	int greenWeight;
+	int redWeight;
+	bool exact;
+};
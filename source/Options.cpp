@@ -0,0 +1,202 @@
+#include "Options.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void PrintUsage(const char* programName)
+{
+	printf("Usage: %s [options]\n", programName);
+	printf("  --replay <path>              replay a video file, image sequence pattern or image directory unthrottled\n");
+	printf("  --replay-timestamps <file>   capture times of the replayed frames in milliseconds, one per line\n");
+	printf("  --replay-fps <fps>           frame rate assumed when the replay has no timing (default 30)\n");
+	printf("  --replay-from <frame>        start a replayed raw frame recording at this frame\n");
+	printf("  --record <file>              record every frame to a raw frame recording that --replay can seek through\n");
+	printf("  --count-allocations          print heap (COUNT_ALLOCATIONS builds) and cv::Mat allocations per second\n");
+	printf("  --sync-capture               capture live frames on the processing thread\n");
+	printf("  --headless                   no windows or keys, tracking and spin tracking start enabled\n");
+	printf("  --reference-gray             use separate OpenCV calls for the gray difference instead of the fused kernel\n");
+	printf("  --verify-fused               run both gray difference versions and report frames where they differ\n");
+	printf("  --predictive-search          only search around the predicted ball and 0 positions once they are followed\n");
+	printf("  --polar-strips               find the ball and 0 along the unwrapped ball track and rotor ring\n");
+	printf("  --rotor-phase                measure the rotor speed every frame from the shift of the rotor ring\n");
+	printf("  --predict                    predict the landing pocket every frame while spin tracking\n");
+	printf("  --leave-speed <deg/s>        ball speed at which it leaves the track (default 200)\n");
+	printf("  --drop-time <s>              time from leaving the track to reaching the rotor (default 0.5)\n");
+	printf("  --reverse-pockets            the pocket order runs the other way round the rotor\n");
+	printf("  --physics                    predict with the ball model from the roulette paper (resources/roulette_paper.pdf)\n");
+	printf("  --wheel <rim>,<deflector>,<incline>,<friction>,<drag>\n");
+	printf("                               ball model: rim and deflector radii (m), stator incline (rad), deceleration\n");
+	printf("                               friction + drag * speed^2 (default 0.41,0.33,0.2,0.5,0.002)\n");
+	printf("  --wheel-file <file>          read the ball model's constants from a file written by Physics_Fitter\n");
+	printf("  --landing-samples <n>        draw n trajectories each frame for the chance of each pocket (default 0: off)\n");
+	printf("  --landing-budget <ms>        time the landing distribution may take each frame (default 5)\n");
+	printf("  --deflectors <n>             deflectors round the stator, scattering the ball (default 8, 0 for no scatter)\n");
+	printf("  --spin-index <file>          predict from the past spins in file most like this one, adding each finished spin\n");
+	printf("  --reference-speed <deg/s>    ball lap speed at which spins are compared (default 400)\n");
+	printf("  --neighbours <n>             past spins voting on each prediction (default 16, at most 64)\n");
+	printf("  --ball-track-radius <r>      outer radius of the ball track around the centre (default: whole capture)\n");
+	printf("  --rotor-ring <inner>,<outer> radii of the ring the 0 is looked for in (default: whole capture)\n");
+	printf("  --history-log <file>         append timings to file once they drop out of memory, and on reset/exit\n");
+	printf("  --region <l>,<t>,<w>,<h>     desktop area to capture in headless live mode\n");
+	printf("  --help                       show this message\n");
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--replay") == 0 && hasValue)
+		{
+			options.replayPath = argv[++i];
+		}
+		else if (strcmp(arg, "--replay-timestamps") == 0 && hasValue)
+		{
+			options.replayTimestampPath = argv[++i];
+		}
+		else if (strcmp(arg, "--count-allocations") == 0)
+		{
+			options.countAllocations = true;
+		}
+		else if (strcmp(arg, "--sync-capture") == 0)
+		{
+			options.syncCapture = true;
+		}
+		else if (strcmp(arg, "--headless") == 0)
+		{
+			options.headless = true;
+		}
+		else if (strcmp(arg, "--reference-gray") == 0)
+		{
+			options.referenceGray = true;
+		}
+		else if (strcmp(arg, "--verify-fused") == 0)
+		{
+			options.verifyFused = true;
+		}
+		else if (strcmp(arg, "--predictive-search") == 0)
+		{
+			options.predictiveSearch = true;
+		}
+		else if (strcmp(arg, "--polar-strips") == 0)
+		{
+			options.polarStrips = true;
+		}
+		else if (strcmp(arg, "--rotor-phase") == 0)
+		{
+			options.rotorPhase = true;
+		}
+		else if (strcmp(arg, "--predict") == 0)
+		{
+			options.predict = true;
+		}
+		else if (strcmp(arg, "--leave-speed") == 0 && hasValue && atof(argv[i + 1]) > 0)
+		{
+			options.leaveSpeed = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--drop-time") == 0 && hasValue && atof(argv[i + 1]) >= 0)
+		{
+			options.dropTime = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--reverse-pockets") == 0)
+		{
+			options.reversePockets = true;
+		}
+		else if (strcmp(arg, "--physics") == 0)
+		{
+			options.physics = true;
+		}
+		else if (strcmp(arg, "--wheel") == 0 && hasValue)
+		{
+			WheelConstants& wheel = options.wheel;
+			if (sscanf(argv[++i], "%lf,%lf,%lf,%lf,%lf", &wheel.rimRadius, &wheel.deflectorRadius, &wheel.statorIncline, &wheel.rollingFriction, &wheel.airDrag) != 5)
+			{
+				printf("Couldn't parse wheel: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--wheel-file") == 0 && hasValue)
+		{
+			if (!LoadWheelConstants(argv[++i], options.wheel))
+			{
+				printf("Couldn't read wheel file: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--landing-samples") == 0 && hasValue && atoi(argv[i + 1]) >= 0)
+		{
+			options.landingSamples = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--landing-budget") == 0 && hasValue && atof(argv[i + 1]) > 0)
+		{
+			options.landingBudget = atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--deflectors") == 0 && hasValue && atoi(argv[i + 1]) >= 0)
+		{
+			options.deflectorCount = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--spin-index") == 0 && hasValue)
+		{
+			options.spinIndexPath = argv[++i];
+		}
+		else if (strcmp(arg, "--reference-speed") == 0 && hasValue && atof(argv[i + 1]) > 0)
+		{
+			options.referenceSpeed = (float)atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--neighbours") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+		{
+			options.neighbours = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--ball-track-radius") == 0 && hasValue)
+		{
+			options.ballTrackRadius = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--rotor-ring") == 0 && hasValue)
+		{
+			if (sscanf(argv[++i], "%d,%d", &options.rotorRingInnerRadius, &options.rotorRingOuterRadius) != 2)
+			{
+				printf("Couldn't parse rotor ring: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--history-log") == 0 && hasValue)
+		{
+			options.historyLogPath = argv[++i];
+		}
+		else if (strcmp(arg, "--region") == 0 && hasValue)
+		{
+			cv::Rect& region = options.captureRegion;
+			if (sscanf(argv[++i], "%d,%d,%d,%d", &region.x, &region.y, &region.width, &region.height) != 4)
+			{
+				printf("Couldn't parse region: %s\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--replay-fps") == 0 && hasValue && atof(argv[i + 1]) > 0)
+		{
+			options.replayFramesPerSecond = atof(argv[++i]);
+		}
+		else if (strcmp(arg, "--replay-from") == 0 && hasValue && atoi(argv[i + 1]) >= 0)
+		{
+			options.replayFrom = atoi(argv[++i]);
+		}
+		else if (strcmp(arg, "--record") == 0 && hasValue)
+		{
+			options.recordPath = argv[++i];
+		}
+		else
+		{
+			if (strcmp(arg, "--help") != 0)
+			{
+				printf("Unknown or incomplete option: %s\n", arg);
+			}
+			PrintUsage(argv[0]);
+			return false;
+		}
+	}
+
+	return true;
+}
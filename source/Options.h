@@ -0,0 +1,103 @@
+#pragma once
+
+#include <string>
+
+#include <opencv2/core/core.hpp>
+
+#include "BallTrajectory.h"
+
+//Settings taken from the command line
+struct Options
+{
+	//Recorded session to replay instead of capturing the desktop
+	std::string replayPath;
+	//Capture times in milliseconds, one per line, for replays that don't carry their own
+	std::string replayTimestampPath;
+	//Frame rate assumed for replays without any timing information
+	double replayFramesPerSecond;
+	//First frame to replay, for raw frame recordings made with --record
+	int replayFrom;
+	//Raw frame recording that every captured or replayed frame is written to
+	std::string recordPath;
+	//Print how many heap and cv::Mat allocations the frame loop made each second
+	bool countAllocations;
+	//Capture live frames on the processing thread instead of a dedicated capture thread
+	bool syncCapture;
+	//Run without any windows or keyboard handling, with tracking enabled from the start
+	bool headless;
+	//Always run the gray difference as separate OpenCV calls instead of the fused kernel
+	bool referenceGray;
+	//Run the fused gray kernel next to the OpenCV calls and report every frame where they differ
+	bool verifyFused;
+	//Search only around where the ball and the 0 are predicted to be, once they are being followed
+	bool predictiveSearch;
+	//Find the ball and the 0 as peaks along the ball track and rotor ring unwrapped to angle x radius
+	bool polarStrips;
+	//Measure the rotor speed every frame by phase correlation of the unwrapped rotor ring
+	bool rotorPhase;
+	//Predict the landing pocket every frame while spin tracking
+	bool predict;
+	//Ball speed in degrees per second at which it leaves the track, for the prediction
+	float leaveSpeed;
+	//Seconds from the ball leaving the track until it reaches the rotor, for the prediction
+	float dropTime;
+	//The pockets are numbered the other way round the rotor from the capture's angles
+	bool reversePockets;
+	//Predict with the ball model from the roulette paper instead of leaveSpeed and dropTime
+	bool physics;
+	//Measurements of the wheel for the ball model
+	WheelConstants wheel;
+	//Trajectories drawn each frame for the landing distribution, 0 for none
+	int landingSamples;
+	//Milliseconds the landing distribution may take each frame
+	double landingBudget;
+	//Deflectors round the stator, which scatter the ball in the landing distribution
+	int deflectorCount;
+	//File of past spins to predict from by their nearest neighbours, and to add finished spins to
+	std::string spinIndexPath;
+	//Ball lap speed in degrees per second at which spins are compared
+	float referenceSpeed;
+	//Past spins voting on each prediction
+	int neighbours;
+	//Outer edge of the ball track around the centre of the capture, 0 to search out to the edges
+	int ballTrackRadius;
+	//Ring the 0 is looked for in, -1 for no inner edge and 0 for no outer edge
+	int rotorRingInnerRadius;
+	int rotorRingOuterRadius;
+	//File that timings are appended to once they are too old to keep in memory
+	std::string historyLogPath;
+	//Desktop area to capture when there is no reference window to position
+	cv::Rect captureRegion;
+
+	Options()
+	{
+		replayFramesPerSecond = 30.0;
+		replayFrom = 0;
+		countAllocations = false;
+		syncCapture = false;
+		headless = false;
+		referenceGray = false;
+		verifyFused = false;
+		predictiveSearch = false;
+		polarStrips = false;
+		rotorPhase = false;
+		predict = false;
+		leaveSpeed = 200.f;
+		dropTime = 0.5f;
+		reversePockets = false;
+		physics = false;
+		landingSamples = 0;
+		landingBudget = 5.0;
+		deflectorCount = 8;
+		referenceSpeed = 400.f;
+		neighbours = 16;
+		ballTrackRadius = 0;
+		rotorRingInnerRadius = -1;
+		rotorRingOuterRadius = 0;
+	}
+};
+
+//Returns false if the arguments couldn't be parsed, after printing the usage
+bool ParseOptions(int argc, char** argv, Options& options);
+
+void PrintUsage(const char* programName);
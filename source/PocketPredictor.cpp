@@ -0,0 +1,102 @@
+#include "PocketPredictor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef M_PI
+	#define M_PI 3.14159265358979323846
+#endif
+
+PocketPredictor::PocketPredictor(const int* pocketOrder, int pocketCount)
+{
+	this->pocketOrder = pocketOrder;
+	this->pocketCount = pocketCount;
+
+	leaveSpeed = 200.f;
+	dropTime = 0.5f;
+	reversePockets = false;
+	trajectory = nullptr;
+}
+
+bool PocketPredictor::Project(double speed, double deceleration, double& secondsToLeave, double& secondsToLand, double& travel) const
+{
+	secondsToLeave = 0;
+	travel = 0;
+	if (trajectory != nullptr && trajectory->IsValid())
+	{
+		const double radiansPerDegree = M_PI / 180.0;
+
+		double rimAngle;
+		trajectory->GetRimPhase(speed * radiansPerDegree, secondsToLeave, rimAngle);
+		travel = (rimAngle + trajectory->GetDescentAngle()) / radiansPerDegree;
+		secondsToLand = secondsToLeave + trajectory->GetDescentTime();
+		return true;
+	}
+
+	//Still on the track until it has slowed to the leave speed, covering the average of the two speeds meanwhile
+	if (speed > leaveSpeed)
+	{
+		if (deceleration <= 0)
+		{
+			return false;
+		}
+
+		secondsToLeave = (speed - leaveSpeed) / deceleration;
+		travel = (speed + leaveSpeed) / 2 * secondsToLeave;
+	}
+
+	//Then down the stator to the rotor
+	travel += std::min(speed, (double)leaveSpeed) * dropTime;
+	secondsToLand = secondsToLeave + dropTime;
+	return true;
+}
+
+int PocketPredictor::GetPocketIndex(double landingAngle, double zeroLandingAngle) const
+{
+	double relativeAngle = std::fmod(landingAngle - zeroLandingAngle, 360.0);
+	if (relativeAngle < 0)
+	{
+		relativeAngle += 360.0;
+	}
+	if (reversePockets)
+	{
+		relativeAngle = 360.0 - relativeAngle;
+	}
+
+	//The 0 is the middle of pocket 0, so round to the nearest pocket centre
+	return (int)std::floor(relativeAngle * pocketCount / 360.0 + 0.5) % pocketCount;
+}
+
+bool PocketPredictor::Predict(Timestamp now, const AngularMotionFit& ball, float zeroAngle, Timestamp zeroTime, float rotorVelocity, PocketPrediction& prediction) const
+{
+	if (!ball.IsValid())
+	{
+		return false;
+	}
+
+	double velocity = ball.PredictAngularVelocity(now);
+	double direction = velocity < 0 ? -1.0 : 1.0;
+
+	double secondsToLeave, secondsToLand, travel;
+	if (!Project(std::fabs(velocity), ball.GetDeceleration(), secondsToLeave, secondsToLand, travel))
+	{
+		return false;
+	}
+
+	double landingAngle = ball.PredictAngle(now) + direction * travel;
+
+	//Where the 0 will be by then
+	double zeroSeconds = std::chrono::duration<double>(now - zeroTime).count() + secondsToLand;
+	double zeroLandingAngle = zeroAngle + rotorVelocity * zeroSeconds;
+
+	int index = GetPocketIndex(landingAngle, zeroLandingAngle);
+
+	double wrappedLandingAngle = std::fmod(landingAngle, 360.0);
+	prediction.pocketIndex = index;
+	prediction.pocket = pocketOrder[index];
+	prediction.landingAngle = (float)(wrappedLandingAngle < 0 ? wrappedLandingAngle + 360.0 : wrappedLandingAngle);
+	prediction.secondsToLeave = (float)secondsToLeave;
+	prediction.secondsToLand = (float)secondsToLand;
+
+	return true;
+}
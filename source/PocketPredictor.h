@@ -0,0 +1,68 @@
+#pragma once
+
+#include "AngularMotionFit.h"
+#include "BallTrajectory.h"
+#include "Clock.h"
+
+struct PocketPrediction
+{
+	//number on the pocket the ball is expected to land in, and its position in the pocket order
+	int pocket;
+	int pocketIndex;
+	//angle (as ToPolar) the ball reaches the rotor at
+	float landingAngle;
+	//seconds from the prediction until the ball leaves the track and until it reaches the rotor
+	float secondsToLeave;
+	float secondsToLand;
+
+	PocketPrediction()
+	{
+		pocket = -1;
+		pocketIndex = -1;
+		landingAngle = 0;
+		secondsToLeave = 0;
+		secondsToLand = 0;
+	}
+};
+
+//Works out which pocket the ball will land in from where the ball and the 0 are now and how fast they are going.
+//The ball keeps slowing at its current deceleration until it drops to leaveSpeed and leaves the track, then takes
+//dropTime to come down to the rotor while carrying on round at leaveSpeed. The rotor keeps turning at its current
+//speed. Where the ball lands relative to the 0 then picks the pocket. A handful of arithmetic and no allocation,
+//so it can be redone every frame.
+//With a trajectory set, the time and travel to leaving the track and down to the rotor come from its precomputed
+//tables instead, and only the ball's current speed is taken from the fit.
+class PocketPredictor
+{
+public:
+	//pocketOrder lists the pocket numbers starting at the 0, in the direction ToPolar's angle increases
+	//unless reversePockets is set
+	PocketPredictor(const int* pocketOrder, int pocketCount);
+
+	//Ball speed in degrees per second at which it leaves the track
+	float leaveSpeed;
+	//Seconds from the ball leaving the track until it reaches the rotor
+	float dropTime;
+	//The pocket order runs the other way round the rotor
+	bool reversePockets;
+	//Physics model of the ball, or null for the constant deceleration model above. Not owned.
+	const BallTrajectory* trajectory;
+
+	//ball is the fit of the ball's angle, zeroAngle the angle the 0 was last seen at at zeroTime,
+	//and rotorVelocity the rotor's speed in degrees per second. Returns false if the ball isn't slowing down.
+	bool Predict(Timestamp now, const AngularMotionFit& ball, float zeroAngle, Timestamp zeroTime, float rotorVelocity, PocketPrediction& prediction) const;
+
+	//The model on its own: from the ball's speed (degrees per second) and deceleration, the seconds until it leaves
+	//the track and until it reaches the rotor, and the degrees it covers meanwhile. False if it never slows down.
+	bool Project(double speed, double deceleration, double& secondsToLeave, double& secondsToLand, double& travel) const;
+
+	//Position in the pocket order of the pocket under landingAngle when the 0 is at zeroLandingAngle
+	int GetPocketIndex(double landingAngle, double zeroLandingAngle) const;
+
+	const int* GetPocketOrder() const { return pocketOrder; }
+	int GetPocketCount() const { return pocketCount; }
+
+private:
+	const int* pocketOrder;
+	int pocketCount;
+};
@@ -0,0 +1,137 @@
+#include "PolarStrip.h"
+
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "PolarTable.h"
+
+PolarStrip::PolarStrip()
+	: center(-1, -1)
+{
+	innerRadius = 0;
+	outerRadius = 0;
+}
+
+bool PolarStrip::Prepare(cv::Point center, int innerRadius, int outerRadius)
+{
+	CV_Assert(innerRadius >= 0 && outerRadius > innerRadius);
+
+	if (center == this->center && innerRadius == this->innerRadius && outerRadius == this->outerRadius)
+	{
+		return false;
+	}
+
+	this->center = center;
+	this->innerRadius = innerRadius;
+	this->outerRadius = outerRadius;
+
+	cv::Size size = GetSize();
+	cv::Mat mapX(size, CV_32FC1);
+	cv::Mat mapY(size, CV_32FC1);
+	for (int y = 0; y < size.height; y++)
+	{
+		float* xs = mapX.ptr<float>(y);
+		float* ys = mapY.ptr<float>(y);
+		for (int x = 0; x < size.width; x++)
+		{
+			cv::Point2f point = FromPolar(center, (float)(innerRadius + y), (x + 0.5f) * 360.f / ANGLE_STEPS);
+			xs[x] = point.x;
+			ys[x] = point.y;
+		}
+	}
+
+	//Nearest neighbour only needs the whole pixel positions, which remap reads fastest as packed shorts
+	cv::Mat unused;
+	cv::convertMaps(mapX, mapY, map, unused, CV_16SC2, true);
+
+	spans.Prepare(size, cv::Point(0, 0), -1, 0);
+
+	return true;
+}
+
+void PolarStrip::Unwrap(const cv::Mat& image, cv::Mat& strip) const
+{
+	cv::remap(image, strip, map, cv::noArray(), cv::INTER_NEAREST, cv::BORDER_CONSTANT, cv::Scalar::all(0));
+}
+
+bool PolarStrip::FindPeak(const cv::Mat& binaryStrip, cv::Point2f& polar)
+{
+	CV_Assert(binaryStrip.type() == CV_8UC1 && binaryStrip.size() == GetSize());
+
+	//Row by row, so the strip is read in memory order
+	columnCounts.assign(ANGLE_STEPS, 0);
+	columnRowSums.assign(ANGLE_STEPS, 0);
+	for (int y = 0; y < binaryStrip.rows; y++)
+	{
+		const uchar* row = binaryStrip.ptr<uchar>(y);
+		for (int x = 0; x < ANGLE_STEPS; x++)
+		{
+			if (row[x] != 0)
+			{
+				columnCounts[x]++;
+				columnRowSums[x] += y;
+			}
+		}
+	}
+
+	//Start just after an empty column so no run is split by the wrap
+	int start = 0;
+	while (start < ANGLE_STEPS && columnCounts[start] != 0)
+	{
+		start++;
+	}
+	if (start == ANGLE_STEPS)
+	{
+		//every column is set, treat it all as one run
+		start = 0;
+	}
+
+	int bestArea = 0;
+	double bestColumn = 0;
+	double bestRow = 0;
+
+	int area = 0;
+	double columnSum = 0;
+	double rowSum = 0;
+	for (int i = 1; i <= ANGLE_STEPS; i++)
+	{
+		int column = (start + i) % ANGLE_STEPS;
+		int count = columnCounts[column];
+		if (count != 0)
+		{
+			//Columns are counted from start so a run keeps increasing through the wrap
+			area += count;
+			columnSum += (double)(start + i) * count;
+			rowSum += columnRowSums[column];
+		}
+
+		if ((count == 0 || i == ANGLE_STEPS) && area > 0)
+		{
+			if (area > bestArea)
+			{
+				bestArea = area;
+				bestColumn = columnSum / area;
+				bestRow = rowSum / area;
+			}
+			area = 0;
+			columnSum = 0;
+			rowSum = 0;
+		}
+	}
+
+	if (bestArea == 0)
+	{
+		return false;
+	}
+
+	float angle = fmodf((float)(bestColumn + 0.5) * 360.f / ANGLE_STEPS, 360.f);
+	polar = cv::Point2f((float)(innerRadius + bestRow), angle);
+	return true;
+}
+
+cv::Point PolarStrip::ToImage(cv::Point2f polar) const
+{
+	cv::Point2f point = FromPolar(center, polar.x, polar.y);
+	return cv::Point(cvRound(point.x), cvRound(point.y));
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AnnulusSpans.h"
+
+//A ring of the capture unwrapped into a strip, with the angle along the columns and the radius down the rows,
+//so something moving round the wheel moves along a row. The remap table is only rebuilt when the centre or
+//radii change. Angles are in degrees and measured the same way as ToPolar.
+class PolarStrip
+{
+public:
+	//Columns in a strip, half a degree each
+	const static int ANGLE_STEPS = 720;
+
+	PolarStrip();
+
+	//outerRadius has to be more than innerRadius. Returns true if the table was rebuilt,
+	//in which case strips unwrapped before no longer line up with new ones.
+	bool Prepare(cv::Point center, int innerRadius, int outerRadius);
+
+	//image is unwrapped into strip, with anything off the edge of the image 0
+	void Unwrap(const cv::Mat& image, cv::Mat& strip) const;
+
+	//Finds the largest run of columns holding set pixels in a binary (CV_8UC1) strip, carrying on across the wrap
+	//from the last column to the first. polar becomes its (radius, angle) around the centre, weighted by the pixels.
+	//Returns false if nothing is set.
+	bool FindPeak(const cv::Mat& binaryStrip, cv::Point2f& polar);
+
+	//Position in the image of a (radius, angle) from FindPeak
+	cv::Point ToImage(cv::Point2f polar) const;
+
+	cv::Size GetSize() const { return cv::Size(ANGLE_STEPS, outerRadius - innerRadius); }
+
+	//Covers the whole strip, for the kernels that work on spans
+	const AnnulusSpans& GetSpans() const { return spans; }
+
+private:
+	//CV_16SC2, the image pixel each strip pixel comes from
+	cv::Mat map;
+	AnnulusSpans spans;
+
+	cv::Point center;
+	int innerRadius;
+	int outerRadius;
+
+	//set pixels in each column, and the sum of their rows
+	std::vector<int> columnCounts;
+	std::vector<int> columnRowSums;
+};
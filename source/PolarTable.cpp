@@ -0,0 +1,62 @@
+#include "PolarTable.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#ifndef M_PI
+	#define M_PI 3.14159265358979323846
+#endif
+
+cv::Point2f ToPolar(cv::Point center, cv::Point point)
+{
+	cv::Point translatedPoint = point - center;
+
+	float radius = sqrtf(powf((float)translatedPoint.x, 2.f) + powf((float)translatedPoint.y, 2.f));
+
+	float angleRadians = atan2f((float)translatedPoint.y, (float)translatedPoint.x);
+	float angleDegrees = (angleRadians + (float)M_PI) * 180 / (float)M_PI;
+
+	return cv::Point2f(radius, angleDegrees);
+}
+
+cv::Point2f FromPolar(cv::Point center, float radius, float angleDegrees)
+{
+	//ToPolar measures from the negative x axis
+	float angleRadians = angleDegrees * (float)M_PI / 180 - (float)M_PI;
+
+	return cv::Point2f(center.x + radius * cosf(angleRadians), center.y + radius * sinf(angleRadians));
+}
+
+float GetAngleDifference(float zeroAngle, float angle)
+{
+	return fmodf((angle - zeroAngle + 180.f + 360.f), 360.f) - 180.f;
+}
+
+PolarTable::PolarTable()
+	: center(-1, -1)
+{
+}
+
+bool PolarTable::Prepare(cv::Size size, cv::Point center, int tolerance)
+{
+	bool sizeChanged = size.width != table.cols || size.height != table.rows;
+	bool centerMoved = std::abs(center.x - this->center.x) > tolerance || std::abs(center.y - this->center.y) > tolerance;
+	if (!sizeChanged && !centerMoved)
+	{
+		return false;
+	}
+
+	this->center = center;
+	table.create(size, CV_32FC2);
+
+	for (int y = 0; y < size.height; y++)
+	{
+		cv::Point2f* row = table.ptr<cv::Point2f>(y);
+		for (int x = 0; x < size.width; x++)
+		{
+			row[x] = ToPolar(center, cv::Point(x, y));
+		}
+	}
+
+	return true;
+}
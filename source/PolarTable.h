@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+//Returns (radius, angle in degrees) of point around center
+cv::Point2f ToPolar(cv::Point center, cv::Point point);
+
+//Inverse of ToPolar
+cv::Point2f FromPolar(cv::Point center, float radius, float angleDegrees);
+
+//Signed difference from zeroAngle to angle in degrees, in [-180, 180)
+float GetAngleDifference(float zeroAngle, float angle);
+
+//(radius, angle) of every pixel of the capture around the wheel centre, so converting a point is a single load.
+//The table only follows the centre once it has moved by more than the tolerance, which keeps it from being
+//rebuilt for every pixel of jitter while the centre estimate settles.
+class PolarTable
+{
+public:
+	PolarTable();
+
+	//Rebuilds the table if the capture size changed or center is more than tolerance pixels from the table's centre.
+	//Returns true if it was rebuilt.
+	bool Prepare(cv::Size size, cv::Point center, int tolerance);
+
+	//Same as ToPolar(center, point) for the centre the table was built around
+	cv::Point2f Get(cv::Point point) const
+	{
+		if ((unsigned)point.x < (unsigned)table.cols && (unsigned)point.y < (unsigned)table.rows)
+		{
+			return table.at<cv::Point2f>(point.y, point.x);
+		}
+
+		//Points off the capture (e.g. (-1, -1) placeholders) don't get an entry
+		return ToPolar(center, point);
+	}
+
+	cv::Point GetCenter() const { return center; }
+
+private:
+	//CV_32FC2, one (radius, angle) per pixel
+	cv::Mat table;
+	cv::Point center;
+};
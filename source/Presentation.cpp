@@ -0,0 +1,264 @@
+#include "Presentation.h"
+
+#include <iostream>
+#include <sstream>
+
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+using namespace std;
+using namespace cv;
+
+//int to string helper function
+string intToString(int number)
+{
+	//this function has a number input and string output
+	std::stringstream ss;
+	ss << number;
+	return ss.str();
+}
+
+void placeCrosshair(Mat &cameraFeed, Point position)
+{
+	//make some temp x and y variables so we dont have to type out so much
+	int x = position.x;
+	int y = position.y;
+
+	//draw some crosshairs around the object
+	cv::circle(cameraFeed, Point(x, y), 20, Scalar(0, 255, 0), 2);
+	cv::line(cameraFeed, Point(x, y), Point(x, y - 25), Scalar(0, 255, 0), 2);
+	cv::line(cameraFeed, Point(x, y), Point(x, y + 25), Scalar(0, 255, 0), 2);
+	cv::line(cameraFeed, Point(x, y), Point(x - 25, y), Scalar(0, 255, 0), 2);
+	cv::line(cameraFeed, Point(x, y), Point(x + 25, y), Scalar(0, 255, 0), 2);
+
+	//write the position of the object to the screen
+	cv::putText(cameraFeed, "Tracking object at (" + intToString(x) + "," + intToString(y) + ")", Point(x, y), 1, 1, Scalar(255, 0, 0), 2);
+}
+
+void DrawSnapshot(const TrackerSnapshot& snapshot, Mat& displayFrame, Mat& overlayFrame)
+{
+	snapshot.frame.copyTo(displayFrame);
+
+	if (snapshot.trackingEnabled)
+	{
+		if (snapshot.ballCenter.x != -1 && snapshot.ballCenter.y != -1)
+		{
+			placeCrosshair(displayFrame, snapshot.ballCenter);
+		}
+		if (snapshot.greenCenter.x != -1 && snapshot.greenCenter.y != -1)
+		{
+			placeCrosshair(displayFrame, snapshot.greenCenter);
+		}
+	}
+
+	if (snapshot.spinTrack)
+	{
+		cv::circle(displayFrame, snapshot.wheelCenter, 5, Scalar(0, 0, 255), -1);
+		cv::line(displayFrame, snapshot.wheelCenter, snapshot.resetPointGreen, Scalar(255, 0, 0), 2);
+		cv::line(displayFrame, snapshot.wheelCenter, snapshot.resetPointBall, Scalar(0, 255, 255), 2);
+
+		for (const Point& p : snapshot.innerWheelPointsPrevious)
+		{
+			cv::circle(displayFrame, p, 2, Scalar(255, 255, 0), -1);
+		}
+		for (const Point& p : snapshot.innerWheelPoints)
+		{
+			cv::circle(displayFrame, p, 2, Scalar(255, 0, 0), -1);
+		}
+		for (const Point& p : snapshot.ballPointsPrevious)
+		{
+			cv::circle(displayFrame, p, 2, Scalar(255, 255, 0), -1);
+		}
+		for (const Point& p : snapshot.ballPoints)
+		{
+			cv::circle(displayFrame, p, 2, Scalar(255, 0, 0), -1);
+		}
+		for (const Point& p : snapshot.ballPointsRadiusDecay)
+		{
+			cv::circle(displayFrame, p, 2, Scalar(0, 0, 255), -1);
+		}
+	}
+
+	if (snapshot.rotorVelocityValid)
+	{
+		//degrees per second to revolutions per minute
+		std::stringstream rotorSpeed;
+		rotorSpeed.precision(1);
+		rotorSpeed << "Rotor: " << std::fixed << snapshot.rotorAngularVelocity / 6.f << " rpm";
+		cv::putText(displayFrame, rotorSpeed.str(), Point(10, 20), 1, 1, Scalar(0, 255, 255), 2);
+	}
+
+	if (snapshot.ballMotionValid)
+	{
+		std::stringstream ballSpeed;
+		ballSpeed.precision(1);
+		ballSpeed << "Ball: " << std::fixed << snapshot.ballAngularVelocity << " deg/s, slowing " << snapshot.ballDeceleration << " deg/s^2";
+		cv::putText(displayFrame, ballSpeed.str(), Point(10, 40), 1, 1, Scalar(0, 255, 255), 2);
+	}
+
+	if (snapshot.predictionValid)
+	{
+		std::stringstream prediction;
+		prediction.precision(1);
+		prediction << "Prediction: " << snapshot.prediction.pocket << " in " << std::fixed << snapshot.prediction.secondsToLand << "s";
+		cv::putText(displayFrame, prediction.str(), Point(10, 60), 1, 1, Scalar(0, 255, 255), 2);
+	}
+
+	if (snapshot.likelyPocketCount > 0)
+	{
+		std::stringstream likely;
+		likely << "Likely:";
+		for (int i = 0; i < snapshot.likelyPocketCount; i++)
+		{
+			likely << " " << snapshot.likelyPockets[i].pocket << " " << (int)(snapshot.likelyPockets[i].probability * 100 + 0.5f) << "%";
+		}
+		cv::putText(displayFrame, likely.str(), Point(10, 80), 1, 1, Scalar(0, 255, 255), 2);
+	}
+
+	if (snapshot.empiricalPocketCount > 0)
+	{
+		std::stringstream empirical;
+		empirical << "Past spins:";
+		for (int i = 0; i < snapshot.empiricalPocketCount; i++)
+		{
+			empirical << " " << snapshot.empiricalPockets[i].pocket << " " << (int)(snapshot.empiricalPockets[i].probability * 100 + 0.5f) << "%";
+		}
+		cv::putText(displayFrame, empirical.str(), Point(10, 100), 1, 1, Scalar(0, 255, 255), 2);
+	}
+
+	//Overlay the mask we use for the grayscale images for reference
+	displayFrame.copyTo(overlayFrame);
+	cv::circle(overlayFrame, cv::Point(displayFrame.cols / 2, displayFrame.rows / 2), snapshot.greenMaskRadius, cv::Scalar(0, 255, 0), -1);
+	double alpha = 0.5;
+
+	cv::addWeighted(overlayFrame, alpha, displayFrame, 1.0 - alpha, 0.0, displayFrame);
+}
+
+void RunPresentation(TripleBuffer<TrackerSnapshot>& snapshots, TrackerControls& controls, const std::atomic<bool>& trackerFinished)
+{
+	Mat displayFrame;
+	Mat overlayFrame;
+	//pause and resume the display
+	bool pause = false;
+	int frameWidth = 0;
+
+	while (!trackerFinished)
+	{
+		if (!pause && snapshots.Acquire())
+		{
+			const TrackerSnapshot& snapshot = snapshots.GetReadSlot();
+			frameWidth = snapshot.frame.cols;
+
+			//The debug flags are checked again in case the windows were closed since the snapshot was taken
+			if (snapshot.greenDebugImages && controls.greenDebug)
+			{
+				cv::imshow("Green Image", snapshot.greenImage);
+				cv::imshow("Difference Image Green", snapshot.differenceImageGreen);
+				cv::imshow("Final Threshold Image Green", snapshot.finalThresholdImageGreen);
+			}
+
+			if (snapshot.debugImages && controls.debugMode)
+			{
+				//show the difference image and threshold image
+				cv::imshow("Difference Image", snapshot.differenceImage);
+				cv::imshow("Threshold Image", snapshot.thresholdImage);
+				//show the threshold image after it's been "blurred"
+				cv::imshow("Final Threshold Image", snapshot.finalThresholdImage);
+			}
+
+			DrawSnapshot(snapshot, displayFrame, overlayFrame);
+
+			//show our captured frame
+			cv::imshow("FinalFrame", displayFrame);
+		}
+
+		//check to see if a button has been pressed.
+		//this delay also gives HighGUI time to refresh the windows, it no longer holds up tracking
+		switch (waitKey(10))
+		{
+		case 27: //'esc' key has been pressed, exit program.
+			controls.quit = true;
+			return;
+		case 116: //'t' has been pressed. this will toggle tracking
+			controls.trackingEnabled = !controls.trackingEnabled;
+			if (controls.trackingEnabled == false)
+			{
+				cout << "Tracking disabled." << endl;
+			}
+			else
+			{
+				cout << "Tracking enabled.\n" << endl;
+			}
+			break;
+		case 100: //'d' has been pressed. this will toggle debug mode
+			controls.debugMode = !controls.debugMode;
+			if (controls.debugMode == false)
+			{
+				cout << "Debug mode disabled." << endl;
+				//destroy the windows so we don't see them anymore
+				cv::destroyWindow("Difference Image");
+				cv::destroyWindow("Threshold Image");
+				cv::destroyWindow("Final Threshold Image");
+			}
+			else
+			{
+				cout << "Debug mode enabled." << endl;
+			}
+			break;
+		case 103: //'g' has been pressed. this will toggle green debug mode
+			controls.greenDebug = !controls.greenDebug;
+			if (controls.greenDebug == false)
+			{
+				cout << "Green debug mode disabled." << endl;
+				cv::destroyWindow("Green Image");
+				cv::destroyWindow("Difference Image Green");
+				cv::destroyWindow("Final Threshold Image Green");
+			}
+			else
+			{
+				cout << "Green debug mode enabled." << endl;
+			}
+			break;
+		case 114: //'r' has been pressed. this will reset the tracking arrays
+			controls.resetRequested = true;
+			break;
+		case 115: //'s' has been pressed. this will toggle writing to the spin tracker
+			controls.spinTrack = !controls.spinTrack;
+			if (controls.spinTrack == false)
+			{
+				cout << "Spin tracking disabled." << endl;
+				controls.resetRequested = true;
+			}
+			else
+			{
+				cout << "Spin tracking enabled." << endl;
+			}
+			break;
+		case 109: //'m' has been pressed. This will increase the radius of the green mask circle
+			{
+				int radius = controls.greenMaskRadius;
+				controls.greenMaskRadius = radius < frameWidth / 2 ? radius + 1 : radius;
+				cout << "Green mask radius increased, it is now: " << controls.greenMaskRadius << endl;
+			}
+			break;
+		case 110: //'n' has been pressed. This will decrease the radius of the green mask circle
+			{
+				int radius = controls.greenMaskRadius;
+				controls.greenMaskRadius = radius > 1 ? radius - 1 : radius;
+				cout << "Green mask radius decreased, it is now: " << controls.greenMaskRadius << endl;
+			}
+			break;
+		case 112: //'p' has been pressed. this will pause/resume the display while tracking carries on.
+			pause = !pause;
+			if (pause == true)
+			{
+				cout << "Display paused, press 'p' again to resume" << endl;
+			}
+			else
+			{
+				cout << "Display resumed" << endl;
+			}
+			break;
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <atomic>
+
+#include <opencv2/core/core.hpp>
+
+#include "TrackerControls.h"
+#include "TrackerSnapshot.h"
+#include "TripleBuffer.h"
+
+void placeCrosshair(cv::Mat &cameraFeed, cv::Point position);
+
+//Draws the detections, laps and mask of a snapshot over a copy of its frame
+void DrawSnapshot(const TrackerSnapshot& snapshot, cv::Mat& displayFrame, cv::Mat& overlayFrame);
+
+//Shows the newest snapshot and handles the keyboard until the tracker finishes or 'esc' is pressed.
+//Has to run on the thread that created the HighGUI windows. Pausing only freezes the display,
+//tracking carries on underneath.
+void RunPresentation(TripleBuffer<TrackerSnapshot>& snapshots, TrackerControls& controls, const std::atomic<bool>& trackerFinished);
@@ -0,0 +1,232 @@
+#include "RecordingFrameSource.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "FrameRecording.h"
+
+//Frames that may be waiting to be written before new ones are dropped, a second or so of capture
+const static int MAX_QUEUED_FRAMES = 32;
+
+RecordingFrameSource::RecordingFrameSource(std::unique_ptr<FrameSource> source)
+	: source(std::move(source)), recordedFrames(0), droppedFrames(0), failed(false)
+{
+	fileOffset = 0;
+	hasFirstTime = false;
+	padding.assign(RECORDING_ALIGNMENT, 0);
+	//Nothing is recorded until Open
+	stopping = true;
+
+	queued.reserve(MAX_QUEUED_FRAMES);
+	written.reserve(MAX_QUEUED_FRAMES);
+	spareImages.reserve(MAX_QUEUED_FRAMES);
+}
+
+RecordingFrameSource::~RecordingFrameSource()
+{
+	Close();
+}
+
+void RecordingFrameSource::Close()
+{
+	if (writeThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		framesQueued.notify_one();
+		writeThread.join();
+	}
+}
+
+bool RecordingFrameSource::Open(const std::string& path)
+{
+	file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	RecordingHeader header;
+	memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+	header.version = RECORDING_VERSION;
+	header.alignment = (uint32_t)RECORDING_ALIGNMENT;
+	file.write((const char*)&header, sizeof(header));
+	file.write(padding.data(), RECORDING_ALIGNMENT - sizeof(header));
+	if (!file.good())
+	{
+		file.close();
+		return false;
+	}
+	fileOffset = RECORDING_ALIGNMENT;
+
+	stopping = false;
+	writeThread = std::thread(&RecordingFrameSource::WriteLoop, this);
+	return true;
+}
+
+bool RecordingFrameSource::Grab(Frame& frame)
+{
+	if (!source->Grab(frame))
+	{
+		return false;
+	}
+
+	Record(frame);
+	return true;
+}
+
+void RecordingFrameSource::Record(const Frame& frame)
+{
+	//Every frame queued or being written holds a buffer, so counting the buffers out counts the backlog
+	cv::Mat buffer;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		//Not open or already closed, Grab can still be running on a capture thread while the recording is closed
+		if (stopping)
+		{
+			return;
+		}
+		if ((int)(queued.size() + written.size()) >= MAX_QUEUED_FRAMES)
+		{
+			droppedFrames++;
+			return;
+		}
+		if (!spareImages.empty())
+		{
+			cv::swap(buffer, spareImages.back());
+			spareImages.pop_back();
+		}
+	}
+
+	//The copy is made without the lock, into a buffer of the same size after the first few frames
+	frame.image.copyTo(buffer);
+
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queued.push_back(PendingFrame());
+		PendingFrame& pending = queued.back();
+		cv::swap(pending.image, buffer);
+		pending.time = frame.time;
+		pending.index = frame.index;
+	}
+	framesQueued.notify_one();
+}
+
+void RecordingFrameSource::WriteLoop()
+{
+	std::unique_lock<std::mutex> lock(queueMutex);
+	while (true)
+	{
+		framesQueued.wait(lock, [this]() { return !queued.empty() || stopping; });
+		if (queued.empty())
+		{
+			break;
+		}
+
+		queued.swap(written);
+
+		//Only the queue needs the lock, not the disk
+		lock.unlock();
+		bool writeFailed = false;
+		for (const PendingFrame& pending : written)
+		{
+			if (!WriteFrame(pending))
+			{
+				writeFailed = true;
+				break;
+			}
+		}
+		file.flush();
+		writeFailed = writeFailed || !file.good();
+		lock.lock();
+
+		for (PendingFrame& pending : written)
+		{
+			spareImages.push_back(cv::Mat());
+			cv::swap(spareImages.back(), pending.image);
+		}
+		written.clear();
+
+		if (writeFailed)
+		{
+			//Nothing more is recorded, Record sees stopping and passes frames straight on
+			failed = true;
+			stopping = true;
+			queued.clear();
+			break;
+		}
+	}
+	lock.unlock();
+
+	//An index would point at chunks that were never written, so a failed recording is left for the replay to walk
+	if (!failed && !WriteIndex())
+	{
+		failed = true;
+	}
+	file.close();
+
+	if (failed)
+	{
+		printf("Couldn't write to the recording, stopped recording after %lld frames\n", GetRecordedFrames());
+	}
+}
+
+bool RecordingFrameSource::WriteFrame(const PendingFrame& pending)
+{
+	if (!hasFirstTime)
+	{
+		firstTime = pending.time;
+		hasFirstTime = true;
+	}
+
+	const cv::Mat& image = pending.image;
+	FrameChunkHeader header;
+	memcpy(header.magic, FRAME_CHUNK_MAGIC, sizeof(header.magic));
+	header.width = image.cols;
+	header.height = image.rows;
+	header.type = image.type();
+	header.step = (int64_t)(image.cols * image.elemSize());
+	header.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(pending.time - firstTime).count();
+	header.index = pending.index;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write(padding.data(), FRAME_DATA_OFFSET - sizeof(header));
+	if (image.isContinuous())
+	{
+		file.write((const char*)image.data, header.step * header.height);
+	}
+	else
+	{
+		for (int row = 0; row < image.rows; row++)
+		{
+			file.write((const char*)image.ptr(row), header.step);
+		}
+	}
+
+	uint64_t chunkSize = GetFrameChunkSize(header.step, header.height);
+	file.write(padding.data(), chunkSize - FRAME_DATA_OFFSET - header.step * header.height);
+	if (!file.good())
+	{
+		return false;
+	}
+
+	chunkOffsets.push_back(fileOffset);
+	fileOffset += chunkSize;
+	recordedFrames++;
+	return true;
+}
+
+bool RecordingFrameSource::WriteIndex()
+{
+	RecordingFooter footer;
+	footer.indexOffset = fileOffset;
+	footer.frameCount = chunkOffsets.size();
+	memcpy(footer.magic, RECORDING_INDEX_MAGIC, sizeof(footer.magic));
+
+	file.write((const char*)chunkOffsets.data(), chunkOffsets.size() * sizeof(uint64_t));
+	file.write((const char*)&footer, sizeof(footer));
+	file.flush();
+	return file.good();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameSource.h"
+
+//Passes on the frames of another source while recording each of them, with its capture time, to a raw frame
+//recording (FrameRecording.h) that MappedFrameSource can replay. Grab only copies the frame into a spare buffer;
+//a background thread does the writing, so a slow disk never holds up capture. If the disk falls behind by more
+//than a few dozen frames, frames are dropped from the recording rather than from the tracking. If the file can't
+//be written (e.g. the disk is full) recording stops, and the file is left without an index so a replay only finds
+//the frames that were written in full.
+class RecordingFrameSource : public FrameSource
+{
+public:
+	RecordingFrameSource(std::unique_ptr<FrameSource> source);
+	~RecordingFrameSource();
+
+	//Creates the recording at path, returns false if it couldn't be
+	bool Open(const std::string& path);
+	//Writes out the frames still queued and the index. Frames grabbed afterwards are passed on but not recorded.
+	void Close();
+
+	bool Grab(Frame& frame) override;
+	bool IsLive() const override { return source->IsLive(); }
+
+	long long GetRecordedFrames() const { return recordedFrames.load(std::memory_order_relaxed); }
+	//Frames that weren't recorded because the writer was too far behind
+	long long GetDroppedFrames() const { return droppedFrames.load(std::memory_order_relaxed); }
+	//Whether recording stopped early because the file couldn't be written
+	bool HasFailed() const { return failed.load(); }
+
+private:
+	struct PendingFrame
+	{
+		cv::Mat image;
+		Timestamp time;
+		int index;
+	};
+
+	void Record(const Frame& frame);
+	void WriteLoop();
+	//Return false if the file couldn't be written
+	bool WriteFrame(const PendingFrame& pending);
+	bool WriteIndex();
+
+	std::unique_ptr<FrameSource> source;
+
+	std::ofstream file;
+	uint64_t fileOffset;
+	//offset of every chunk written, for the index at the end
+	std::vector<uint64_t> chunkOffsets;
+	bool hasFirstTime;
+	Timestamp firstTime;
+	std::vector<char> padding;
+
+	//frames waiting for the writer thread, swapped with written so neither side reallocates once warmed up,
+	//and the buffers they came in, handed back once they are written
+	std::vector<PendingFrame> queued;
+	std::vector<PendingFrame> written;
+	std::vector<cv::Mat> spareImages;
+	bool stopping;
+	std::mutex queueMutex;
+	std::condition_variable framesQueued;
+
+	std::atomic<long long> recordedFrames;
+	std::atomic<long long> droppedFrames;
+	std::atomic<bool> failed;
+
+	std::thread writeThread;
+};
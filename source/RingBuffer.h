@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+
+//Fixed capacity FIFO that overwrites its oldest item once full. All storage is allocated up front,
+//so pushing never allocates however long it runs.
+template <typename T>
+class RingBuffer
+{
+public:
+	explicit RingBuffer(int capacity)
+		: items(capacity)
+	{
+		start = 0;
+		count = 0;
+	}
+
+	//Adds item at the back. If the buffer was full the oldest item is moved to evicted and true is returned.
+	bool Push(const T& item, T& evicted)
+	{
+		int capacity = (int)items.size();
+		if (count < capacity)
+		{
+			items[(start + count) % capacity] = item;
+			count++;
+			return false;
+		}
+
+		evicted = std::move(items[start]);
+		items[start] = item;
+		start = (start + 1) % capacity;
+		return true;
+	}
+
+	void Clear()
+	{
+		start = 0;
+		count = 0;
+	}
+
+	int Size() const { return count; }
+	int Capacity() const { return (int)items.size(); }
+	bool IsEmpty() const { return count == 0; }
+
+	//0 is the oldest item
+	const T& operator[](int index) const
+	{
+		return items[(start + index) % items.size()];
+	}
+
+	const T& Back() const
+	{
+		return (*this)[count - 1];
+	}
+
+private:
+	std::vector<T> items;
+	int start;
+	int count;
+};
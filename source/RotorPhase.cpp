@@ -0,0 +1,144 @@
+#include "RotorPhase.h"
+
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+//Share of each new measurement taken into the smoothed velocity
+const static float VELOCITY_SMOOTHING = 0.3f;
+//Once the velocity is known the peak is only looked for this many degrees either side of where the rotor
+//should have got to. A pocket is just under 10 degrees, so the pocket pattern's own repeats are kept out.
+const static float SEARCH_DEGREES = 4.f;
+//Peaks weaker than this are noise, e.g. while the ring is covered
+const static float MIN_PEAK_STRENGTH = 0.05f;
+
+RotorPhase::RotorPhase()
+{
+	Reset();
+}
+
+void RotorPhase::Reset()
+{
+	hasPrevious = false;
+	hasVelocity = false;
+	shift = 0;
+	angularVelocity = 0;
+	measurementVariance = 0;
+	peakStrength = 0;
+}
+
+float RotorPhase::GetVelocityVariance() const
+{
+	//Exponential smoothing keeps smoothing / (2 - smoothing) of the variance of the measurements it averages
+	return measurementVariance * VELOCITY_SMOOTHING / (2 - VELOCITY_SMOOTHING);
+}
+
+bool RotorPhase::Update(const cv::Mat& ring, Timestamp time)
+{
+	CV_Assert(ring.depth() == CV_8U && (ring.channels() == 1 || ring.channels() == 4));
+
+	if (ring.channels() == 4)
+	{
+		cv::cvtColor(ring, gray, cv::COLOR_BGRA2GRAY);
+		gray.convertTo(samples, CV_32F);
+	}
+	else
+	{
+		ring.convertTo(samples, CV_32F);
+	}
+
+	//Each row is one circle round the rotor, so its DFT is exactly periodic without any windowing
+	cv::dft(samples, spectrum, cv::DFT_ROWS | cv::DFT_COMPLEX_OUTPUT);
+
+	bool compared = false;
+	float elapsed = std::chrono::duration<float>(time - previousTime).count();
+	if (hasPrevious && previousSpectrum.size() == spectrum.size() && elapsed > 0)
+	{
+		//current * conj(previous) peaks at the shift that takes the previous ring onto the current one
+		cv::mulSpectrums(spectrum, previousSpectrum, crossPower, cv::DFT_ROWS, true);
+		cv::reduce(crossPower, summedCrossPower, 0, cv::REDUCE_SUM);
+
+		//Leave out the mean brightness (lighting changes) and normalise the rest to pure phase
+		int columns = summedCrossPower.cols;
+		float* bins = summedCrossPower.ptr<float>(0);
+		bins[0] = bins[1] = 0;
+		for (int k = 1; k < columns; k++)
+		{
+			float* bin = bins + 2 * k;
+			float magnitude = std::sqrt(bin[0] * bin[0] + bin[1] * bin[1]);
+			float scale = magnitude > 1e-6f ? 1 / magnitude : 0.f;
+			bin[0] *= scale;
+			bin[1] *= scale;
+		}
+
+		cv::dft(summedCrossPower, correlation, cv::DFT_INVERSE | cv::DFT_REAL_OUTPUT | cv::DFT_SCALE);
+		const float* values = correlation.ptr<float>(0);
+
+		float degreesPerColumn = 360.f / columns;
+		int first = 0;
+		int count = columns;
+		if (hasVelocity)
+		{
+			float expectedColumn = angularVelocity * elapsed / degreesPerColumn;
+			int reach = (int)std::ceil(SEARCH_DEGREES / degreesPerColumn);
+			first = (int)std::floor(expectedColumn + 0.5f) - reach;
+			count = std::min(2 * reach + 1, columns);
+		}
+
+		int best = 0;
+		float bestValue = -1;
+		for (int i = 0; i < count; i++)
+		{
+			int column = ((first + i) % columns + columns) % columns;
+			if (values[column] > bestValue)
+			{
+				bestValue = values[column];
+				best = column;
+			}
+		}
+
+		if (bestValue >= MIN_PEAK_STRENGTH)
+		{
+			//Parabola through the peak and its neighbours for the part of a column
+			float left = values[(best + columns - 1) % columns];
+			float right = values[(best + 1) % columns];
+			float curvature = left - 2 * bestValue + right;
+			float offset = curvature < 0 ? 0.5f * (left - right) / curvature : 0.f;
+
+			float shiftColumns = best + offset;
+			if (shiftColumns > columns / 2)
+			{
+				shiftColumns -= columns;
+			}
+
+			shift = shiftColumns * degreesPerColumn;
+			peakStrength = bestValue;
+
+			float measured = shift / elapsed;
+			if (hasVelocity)
+			{
+				float error = measured - angularVelocity;
+				measurementVariance += VELOCITY_SMOOTHING * (error * error - measurementVariance);
+				angularVelocity += VELOCITY_SMOOTHING * error;
+			}
+			else
+			{
+				angularVelocity = measured;
+				measurementVariance = 0;
+			}
+			hasVelocity = true;
+			compared = true;
+		}
+		else
+		{
+			//Lost it, look everywhere again next time
+			hasVelocity = false;
+		}
+	}
+
+	cv::swap(spectrum, previousSpectrum);
+	previousTime = time;
+	hasPrevious = true;
+
+	return compared;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+#include "Clock.h"
+
+//Measures the rotor's angular velocity every frame from how far its unwrapped ring (a PolarStrip, angle along
+//the columns) has shifted since the previous frame. The shift is the peak of the circular cross-correlation of
+//the two rings, worked out per row with cv::dft and summed over the rows, with each frequency normalised to
+//unit magnitude (phase correlation) so the sharp edges of the pockets count as much as the broad shading.
+class RotorPhase
+{
+public:
+	RotorPhase();
+
+	//Forget the previous ring and the velocity, e.g. after the strip was rebuilt
+	void Reset();
+
+	//ring is CV_8UC1 or CV_8UC4. Returns true if it could be compared against a previous ring,
+	//in which case GetShift and GetAngularVelocity describe the latest frame.
+	bool Update(const cv::Mat& ring, Timestamp time);
+
+	bool HasVelocity() const { return hasVelocity; }
+
+	//Degrees turned between the last two rings, positive in the direction ToPolar's angle increases
+	float GetShift() const { return shift; }
+
+	//Degrees per second, smoothed over the last few frames
+	float GetAngularVelocity() const { return angularVelocity; }
+
+	//How far off the smoothed velocity is likely to be, from how much the frames' measurements scatter around it
+	float GetVelocityVariance() const;
+
+	//Height of the correlation peak, 1 for a perfect match and near 0 for no match at all
+	float GetPeakStrength() const { return peakStrength; }
+
+private:
+	cv::Mat gray;
+	cv::Mat samples;
+	cv::Mat spectrum;
+	cv::Mat previousSpectrum;
+	cv::Mat crossPower;
+	cv::Mat summedCrossPower;
+	cv::Mat correlation;
+
+	bool hasPrevious;
+	Timestamp previousTime;
+
+	bool hasVelocity;
+	float shift;
+	float angularVelocity;
+	float measurementVariance;
+	float peakStrength;
+};
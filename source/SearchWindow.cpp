@@ -0,0 +1,116 @@
+#include "SearchWindow.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "PolarTable.h"
+
+//How much of each measurement the filter takes on for the angle (and radius) and for the angular velocity
+const static float ALPHA = 0.5f;
+const static float BETA = 0.2f;
+//Detections in a row before the window is trusted, and misses in a row before it is given up on
+const static int DETECTIONS_TO_LOCK = 3;
+const static int MISSES_TO_UNLOCK = 2;
+//Half the size of the window around the prediction, before adding the distance moved in a frame.
+//Needs to fit the difference blob, which covers both the previous and the current position.
+const static int WINDOW_MARGIN = 48;
+
+SearchWindow::SearchWindow()
+{
+	Reset();
+}
+
+void SearchWindow::Reset()
+{
+	initialised = false;
+	locked = false;
+	angle = 0;
+	angularVelocity = 0;
+	radius = 0;
+	consecutiveDetections = 0;
+	consecutiveMisses = 0;
+}
+
+void SearchWindow::Update(cv::Point detection, Timestamp time, cv::Point wheelCenter)
+{
+	if (detection.x == -1 && detection.y == -1)
+	{
+		consecutiveDetections = 0;
+		consecutiveMisses++;
+		if (consecutiveMisses > MISSES_TO_UNLOCK)
+		{
+			initialised = false;
+			locked = false;
+		}
+		return;
+	}
+
+	cv::Point2f measured = ToPolar(wheelCenter, detection);
+
+	if (!initialised)
+	{
+		initialised = true;
+		angle = measured.y;
+		radius = measured.x;
+		angularVelocity = 0;
+		lastTime = time;
+		consecutiveDetections = 1;
+		consecutiveMisses = 0;
+		return;
+	}
+
+	float elapsed = std::chrono::duration<float>(time - lastTime).count();
+	lastTime = time;
+	consecutiveDetections++;
+	consecutiveMisses = 0;
+	if (consecutiveDetections >= DETECTIONS_TO_LOCK)
+	{
+		locked = true;
+	}
+
+	if (elapsed <= 0)
+	{
+		return;
+	}
+
+	//Predict forward, then correct by a share of how far off the prediction was
+	float predictedAngle = fmodf(angle + angularVelocity * elapsed, 360.f);
+	if (predictedAngle < 0)
+	{
+		predictedAngle += 360.f;
+	}
+	float residual = GetAngleDifference(predictedAngle, measured.y);
+
+	angle = fmodf(predictedAngle + ALPHA * residual + 360.f, 360.f);
+	angularVelocity += BETA * residual / elapsed;
+	radius += ALPHA * (measured.x - radius);
+}
+
+cv::Rect SearchWindow::GetWindow(Timestamp time, cv::Point wheelCenter, cv::Size frameSize) const
+{
+	if (!locked)
+	{
+		return cv::Rect();
+	}
+
+	float elapsed = std::chrono::duration<float>(time - lastTime).count();
+	cv::Point2f predicted = FromPolar(wheelCenter, radius, angle + angularVelocity * elapsed);
+
+	//Allow for the distance covered in one frame at the current speed, and grow the window while the object is missing
+	float step = std::fabs(angularVelocity * elapsed) * (float)CV_PI / 180 * radius;
+	int halfSize = (int)(WINDOW_MARGIN + step) * (1 + consecutiveMisses);
+	//rounded up so the window keeps the same size from frame to frame
+	halfSize = (halfSize + 15) & ~15;
+
+	int size = 2 * halfSize;
+	if (size >= frameSize.width || size >= frameSize.height)
+	{
+		return cv::Rect();
+	}
+
+	//Slide the window back inside the frame rather than cutting it down
+	int left = std::min(std::max(cvRound(predicted.x) - halfSize, 0), frameSize.width - size);
+	int top = std::min(std::max(cvRound(predicted.y) - halfSize, 0), frameSize.height - size);
+
+	return cv::Rect(left, top, size, size);
+}
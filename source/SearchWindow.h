@@ -0,0 +1,36 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+#include "Clock.h"
+
+//Follows one object round the wheel with an alpha-beta filter on its angle and radius around the wheel centre,
+//and works out the small part of the next frame it can be in. Until the object has been seen a few frames
+//in a row, or once it has been missed a few frames in a row, there is no window and the whole frame is searched.
+class SearchWindow
+{
+public:
+	SearchWindow();
+
+	void Reset();
+
+	//Feeds in this frame's detection, (-1, -1) if the object wasn't found
+	void Update(cv::Point detection, Timestamp time, cv::Point wheelCenter);
+
+	//Region of a frame taken at time to search, or an empty Rect to search all of it
+	cv::Rect GetWindow(Timestamp time, cv::Point wheelCenter, cv::Size frameSize) const;
+
+private:
+	bool initialised;
+	//seen enough frames in a row to search only around the prediction
+	bool locked;
+	//degrees, as ToPolar
+	float angle;
+	//degrees per second
+	float angularVelocity;
+	float radius;
+	Timestamp lastTime;
+
+	int consecutiveDetections;
+	int consecutiveMisses;
+};
@@ -0,0 +1,50 @@
+#include "SpinHistory.h"
+
+#include <cstdio>
+#include <fstream>
+
+//Longer than any lap in the rim, so a gap this long between ball timings is a new spin whose reset wasn't logged
+const static double MAX_LAP_GAP = 5.0;
+
+bool LoadSpinHistory(const std::string& path, std::vector<RecordedSpin>& spins)
+{
+	std::ifstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	//Every spin starts empty, and empty ones are dropped at the end
+	spins.push_back(RecordedSpin());
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		long long microseconds;
+		BallLap lap;
+		int milliseconds;
+		if (sscanf(line.c_str(), "ball,%lld,%f,%f,%d", &microseconds, &lap.radius, &lap.angle, &milliseconds) == 4)
+		{
+			lap.time = microseconds / 1e6;
+			lap.seconds = milliseconds / 1e3;
+
+			std::vector<BallLap>& laps = spins.back().laps;
+			if (!laps.empty() && lap.time - laps.back().time > MAX_LAP_GAP)
+			{
+				spins.push_back(RecordedSpin());
+			}
+			spins.back().laps.push_back(lap);
+		}
+		else if (line.compare(0, 6, "reset,") == 0 && !spins.back().laps.empty())
+		{
+			spins.push_back(RecordedSpin());
+		}
+	}
+
+	if (spins.back().laps.empty())
+	{
+		spins.pop_back();
+	}
+
+	return true;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//One ball timing read back from a history log: the ball went once round the wheel in seconds, ending at time
+struct BallLap
+{
+	//seconds since the start of the recording
+	double time;
+	double seconds;
+	//where the ball was at time, in pixels from the wheel centre and degrees as ToPolar gives them
+	float radius;
+	float angle;
+};
+
+//The ball timings of one spin, in the order they were logged
+struct RecordedSpin
+{
+	std::vector<BallLap> laps;
+};
+
+//Reads a history log written by FinishedPointLog and appends its spins to spins. A spin ends at a reset
+//marker, or where the ball timings stop for longer than a lap could take. Wheel timings are skipped.
+//Returns false if the file couldn't be opened.
+bool LoadSpinHistory(const std::string& path, std::vector<RecordedSpin>& spins);
@@ -0,0 +1,144 @@
+#include "SpinIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+const static char MAGIC[4] = { 'S', 'P', 'I', 'X' };
+const static int VERSION = 1;
+//The tree is rebuilt once the spins outside it are this share of the ones in it, or this many if that's more.
+//Rebuilding from scratch each time keeps the tree balanced, and happens less and less often as the index grows.
+const static int REBUILD_SHARE = 8;
+const static int MIN_REBUILD_SPINS = 256;
+//Largest leaf of the tree, where the search checks every spin
+const static int LEAF_SIZE = 16;
+
+struct SpinIndexHeader
+{
+	char magic[4];
+	int version;
+	int features;
+};
+
+SpinIndex::SpinIndex()
+{
+	treeSize = 0;
+}
+
+bool SpinIndex::Open(const std::string& path)
+{
+	features.clear();
+	outcomes.clear();
+	tree.reset();
+	treeSize = 0;
+
+	SpinIndexHeader header;
+	std::ifstream existing(path, std::ios::binary);
+	bool empty = !existing.is_open() || existing.peek() == std::ifstream::traits_type::eof();
+	if (!empty)
+	{
+		if (!existing.read((char*)&header, sizeof(header)) || memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+			|| header.version != VERSION || header.features != FEATURES)
+		{
+			return false;
+		}
+
+		//A record cut short by a crash mid-append is dropped, and overwritten by the next one
+		float record[FEATURES + 1];
+		while (existing.read((char*)record, sizeof(record)))
+		{
+			features.insert(features.end(), record, record + FEATURES);
+			outcomes.push_back(record[FEATURES]);
+		}
+	}
+	existing.close();
+
+	if (empty)
+	{
+		file.open(path, std::ios::binary | std::ios::trunc);
+		memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.features = FEATURES;
+		file.write((const char*)&header, sizeof(header));
+	}
+	else
+	{
+		//Positioned after the last whole record rather than appending, to overwrite any partial one
+		file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(sizeof(header) + outcomes.size() * (FEATURES + 1) * sizeof(float));
+	}
+	file.flush();
+
+	if (!file.good())
+	{
+		return false;
+	}
+
+	Rebuild();
+	return true;
+}
+
+void SpinIndex::Add(const float* spinFeatures, float outcome)
+{
+	features.insert(features.end(), spinFeatures, spinFeatures + FEATURES);
+	outcomes.push_back(outcome);
+
+	if (file.is_open())
+	{
+		file.write((const char*)spinFeatures, FEATURES * sizeof(float));
+		file.write((const char*)&outcome, sizeof(float));
+		file.flush();
+	}
+
+	int outside = GetSize() - treeSize;
+	if (outside >= std::max(MIN_REBUILD_SPINS, treeSize / REBUILD_SHARE))
+	{
+		Rebuild();
+	}
+}
+
+void SpinIndex::Rebuild()
+{
+	treeSize = GetSize();
+	if (treeSize == 0)
+	{
+		tree.reset();
+		return;
+	}
+
+	//The tree copies the spins in its own order while it is built, so it doesn't point into features afterwards
+	cvflann::Matrix<float> dataset(features.data(), treeSize, FEATURES);
+	tree.reset(new Tree(dataset, cvflann::KDTreeSingleIndexParams(LEAF_SIZE)));
+	tree->buildIndex();
+}
+
+int SpinIndex::FindNearest(const float* query, int count, int* indices, float* distances) const
+{
+	count = std::min(count, (int)MAX_NEIGHBOURS);
+	if (count <= 0 || GetSize() == 0)
+	{
+		return 0;
+	}
+
+	cvflann::KNNResultSet<float> results(count);
+	results.init(indices, distances);
+
+	if (tree)
+	{
+		tree->findNeighbors(results, query, cvflann::SearchParams());
+	}
+
+	//The spins added since the tree was built go through the same result set
+	for (int index = treeSize; index < GetSize(); index++)
+	{
+		const float* spin = &features[index * FEATURES];
+		float distance = 0;
+		for (int i = 0; i < FEATURES; i++)
+		{
+			float difference = spin[i] - query[i];
+			distance += difference * difference;
+		}
+		results.addPoint(distance, index);
+	}
+
+	return (int)results.size();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/flann/dist.h>
+#include <opencv2/flann/kdtree_single_index.h>
+
+//Past spins described by a few speeds each, with how each spin came out, kept in a file so the history carries
+//over between sessions. The file is a short header followed by one fixed-size record per spin, so a new spin is
+//one append. Most of the spins are searched through a k-d tree (FLANN's single tree, which gives the exact
+//nearest neighbours). Spins added since the tree was built are checked one by one, and the tree is rebuilt
+//once there are enough of them to slow that down.
+class SpinIndex
+{
+public:
+	//Speeds describing a spin, see EmpiricalPredictor
+	const static int FEATURES = 5;
+	//Most neighbours a search can return
+	const static int MAX_NEIGHBOURS = 64;
+
+	SpinIndex();
+
+	//Reads the spins already in path, creating it if it doesn't exist, and appends new spins to it from then on.
+	//Returns false if the file couldn't be opened or isn't a spin index.
+	bool Open(const std::string& path);
+
+	int GetSize() const { return (int)outcomes.size(); }
+
+	void Add(const float* features, float outcome);
+
+	//Fills indices and squared distances with the up to count nearest spins to features, nearest first,
+	//and returns how many were found
+	int FindNearest(const float* features, int count, int* indices, float* distances) const;
+
+	float GetOutcome(int index) const { return outcomes[index]; }
+
+private:
+	typedef cvflann::KDTreeSingleIndex<cvflann::L2<float>> Tree;
+
+	void Rebuild();
+
+	//FEATURES per spin
+	std::vector<float> features;
+	std::vector<float> outcomes;
+
+	//the first treeSize spins are in the tree, which keeps its own reordered copy of them
+	std::unique_ptr<Tree> tree;
+	int treeSize;
+
+	std::ofstream file;
+};
@@ -0,0 +1,315 @@
+#include "SpinTracker.h"
+
+#include "FinishedPointLog.h"
+
+#include <cmath>
+#include <cstdio>
+
+//How far the wheel centre may drift before the polar table is rebuilt around it
+const static int POLAR_TABLE_TOLERANCE = 1;
+//Timings kept in memory for each of the wheel and the ball, about an hour of a spinning wheel at 30fps
+const static int FINISHED_POINT_CAPACITY = 1 << 17;
+//Points a single lap or trail may hold, far more than a real lap takes
+const static int LAP_CAPACITY = 1 << 14;
+//Weight the wheel circle fit keeps on its older points per new one, so it covers roughly the last thousand sightings of the 0
+const static double WHEEL_FIT_FORGETTING = 0.999;
+//Weight the ball's motion fit keeps on its older sightings per new one, roughly a third of a second at 30fps,
+//and the longest the ball can go unseen before the fit starts again
+const static double BALL_MOTION_FORGETTING = 0.9;
+const static double BALL_MOTION_MAX_GAP = 0.5;
+
+bool IsPointBetweenTwoPoints(const PolarTable& polar, cv::Point point, cv::Point point1, cv::Point point2)
+{
+	cv::Point2f pointPolar = polar.Get(point);
+	cv::Point2f point1Polar = polar.Get(point1);
+	cv::Point2f point2Polar = polar.Get(point2);
+
+	float anglePoint1 = GetAngleDifference(pointPolar.y, point1Polar.y);
+	float anglePoint2 = GetAngleDifference(pointPolar.y, point2Polar.y);
+	
+	return (anglePoint1 >= 0.f && anglePoint1 < 90.f && anglePoint2 < 0.f && anglePoint2 > -90.f) ||
+		   (anglePoint2 >= 0.f && anglePoint2 < 90.f && anglePoint1 < 0.f && anglePoint1 > -90.f);
+}
+
+float GetEstimatedRadiusDifference(cv::Point2f pointPolar, float resetAngle, const LapTable& previousLap)
+{
+	float radiusDifference = 0;
+
+	if (previousLap.IsEmpty())
+	{
+		return radiusDifference;
+	}
+
+	//Find the nearest point in both directions in the previous lap
+	int nearestPointNeg, nearestPointPos;
+	float nearestDistNeg, nearestDistPos;
+	previousLap.FindNeighbours(pointPolar.y, resetAngle, nearestPointNeg, nearestDistNeg, nearestPointPos, nearestDistPos);
+
+	//Interpolate between the two points' radii based on their distance to the current point to find the estimated radius of the current point
+	if (nearestPointNeg != -1 && nearestPointPos != -1)
+	{
+		//Set it up such that distNeg = 0, distPos = 1.0, and 0 < distCurrent < 1.0
+		float distCurrent = -nearestDistNeg;
+		float distPos = nearestDistPos - nearestDistNeg;
+
+		distCurrent = distPos == 0 ? 0 : distCurrent / distPos;
+
+		//Linearly interpolate between the time at the negative point and the time at the positive point
+		float negativePointRadius = previousLap.GetRadius(nearestPointNeg);
+		float positivePointRadius = previousLap.GetRadius(nearestPointPos);
+
+		float distCurrentInverse = 1.f - distCurrent;
+		float projectedNearestPointRadius = distCurrentInverse * negativePointRadius + distCurrent * positivePointRadius;
+
+		radiusDifference = std::fabs(projectedNearestPointRadius - pointPolar.x);
+	}
+	else if (nearestPointNeg != -1)
+	{
+		radiusDifference = std::fabs(previousLap.GetRadius(nearestPointNeg) - pointPolar.x);
+	}
+	else if (nearestPointPos != -1)
+	{
+		radiusDifference = std::fabs(previousLap.GetRadius(nearestPointPos) - pointPolar.x);
+	}
+	
+	return radiusDifference;
+}
+
+//Returns time around in milliseconds
+int GetTimeAround(float angle, float resetAngle, Timestamp time, const LapTable& previousLap)
+{
+	int timeAround = -1;
+
+	if (previousLap.IsEmpty())
+	{
+		return timeAround;
+	}
+
+	//Find the nearest point in both directions in the previous lap
+	int nearestPointNeg, nearestPointPos;
+	float nearestDistNeg, nearestDistPos;
+	previousLap.FindNeighbours(angle, resetAngle, nearestPointNeg, nearestDistNeg, nearestPointPos, nearestDistPos);
+
+	//Interpolate between the two points' times based on their distance to the current point
+	if (nearestPointNeg != -1 && nearestPointPos != -1)
+	{
+		//Set it up such that distNeg = 0, distPos = 1.0, and 0 < distCurrent < 1.0
+		float distCurrent = -nearestDistNeg;
+		float distPos = nearestDistPos - nearestDistNeg;
+
+		distCurrent = distPos == 0 ? 0 : distCurrent / distPos;
+
+		//Linearly interpolate between the time at the negative point and the time at the positive point.
+		//Work relative to the negative point so large clock values don't lose precision in the float maths.
+		Timestamp negativePointTime = previousLap.GetTime(nearestPointNeg);
+		Timestamp positivePointTime = previousLap.GetTime(nearestPointPos);
+		auto pointInterval = std::chrono::duration_cast<std::chrono::microseconds>(positivePointTime - negativePointTime).count();
+		Timestamp projectedNearestPointTime = negativePointTime + std::chrono::microseconds((long long)(distCurrent * pointInterval));
+
+		timeAround = (int)std::chrono::duration_cast<std::chrono::milliseconds>(time - projectedNearestPointTime).count();
+	}
+	
+	return timeAround;
+}
+
+SpinTracker::SpinTracker()
+	: wheelCenter(-1, -1), greenPointPrevious(-1, -1), ballPointPrevious(-1, -1), resetPointGreen(-1, -1), resetPointBall(-1, -1),
+	  ballSpeeds(FINISHED_POINT_CAPACITY), wheelSpeeds(FINISHED_POINT_CAPACITY), wheelFit(WHEEL_FIT_FORGETTING),
+	  ballMotion(BALL_MOTION_FORGETTING, BALL_MOTION_MAX_GAP)
+{
+	ballSpeedCount = 0;
+	wheelSpeedCount = 0;
+	finishedPointLog = nullptr;
+}
+
+void SpinTracker::AddFinishedPoint(FinishedPointKind kind, const FinishedPoint& point)
+{
+	RingBuffer<FinishedPoint>& speeds = kind == FINISHED_WHEEL ? wheelSpeeds : ballSpeeds;
+
+	FinishedPoint evicted;
+	if (speeds.Push(point, evicted) && finishedPointLog != nullptr)
+	{
+		finishedPointLog->Write(kind, evicted);
+	}
+
+	if (kind == FINISHED_WHEEL)
+	{
+		wheelSpeedCount++;
+	}
+	else
+	{
+		ballSpeedCount++;
+	}
+}
+
+void SpinTracker::LimitLap(TrackStore& points)
+{
+	//Dropping half at a time keeps the cost of the erase spread thin
+	if (points.Size() > LAP_CAPACITY)
+	{
+		points.DropOldest(LAP_CAPACITY / 2);
+	}
+}
+
+void SpinTracker::FlushHistory()
+{
+	if (finishedPointLog != nullptr)
+	{
+		for (int i = 0; i < wheelSpeeds.Size(); i++)
+		{
+			finishedPointLog->Write(FINISHED_WHEEL, wheelSpeeds[i]);
+		}
+		for (int i = 0; i < ballSpeeds.Size(); i++)
+		{
+			finishedPointLog->Write(FINISHED_BALL, ballSpeeds[i]);
+		}
+	}
+
+	wheelSpeeds.Clear();
+	ballSpeeds.Clear();
+}
+
+void SpinTracker::Reset()
+{
+	resetPointGreen = cv::Point(-1, -1);
+	resetPointBall = cv::Point(-1, -1);
+
+	innerWheelPointsPrevious.Clear();
+	innerWheelPoints.Clear();
+
+	ballPointsPrevious.Clear();
+	ballPoints.Clear();
+	ballPointsRadiusDecay.Clear();
+
+	FlushHistory();
+	if (finishedPointLog != nullptr)
+	{
+		finishedPointLog->WriteReset(lastTime);
+	}
+
+	innerWheelLap.Clear();
+	ballLap.Clear();
+
+	wheelFit.Clear();
+	ballMotion.Clear();
+}
+
+void SpinTracker::PrepareGeometry()
+{
+	//The stored points' polar coordinates are relative to the old centre, so they have to follow the table
+	if (polarTable.Prepare(captureSize, wheelCenter, POLAR_TABLE_TOLERANCE))
+	{
+		innerWheelPoints.UpdatePolar(polarTable);
+		innerWheelPointsPrevious.UpdatePolar(polarTable);
+		ballPoints.UpdatePolar(polarTable);
+		ballPointsPrevious.UpdatePolar(polarTable);
+		ballPointsRadiusDecay.UpdatePolar(polarTable);
+
+		innerWheelLap.Build(innerWheelPointsPrevious);
+		ballLap.Build(ballPointsPrevious);
+	}
+}
+
+void SpinTracker::Update(cv::Point ballCenter, cv::Point greenCenter, Timestamp time)
+{
+	lastTime = time;
+	PrepareGeometry();
+
+	//Track the green 0
+	if(greenCenter.x != -1 && greenCenter.y != -1)
+	{
+		//If we don't already have a reset point
+		if (resetPointGreen == cv::Point(-1, -1))
+		{
+			resetPointGreen = greenCenter;
+		}
+		else
+		{
+			if (!innerWheelPoints.IsEmpty())
+			{
+				greenPointPrevious = innerWheelPoints.Back();
+			}
+
+			if (IsPointBetweenTwoPoints(polarTable, resetPointGreen, greenCenter, greenPointPrevious))
+			{
+				//swap so both laps keep their capacity instead of copying
+				innerWheelPointsPrevious.Swap(innerWheelPoints);
+				innerWheelPoints.Clear();
+				innerWheelLap.Build(innerWheelPointsPrevious);
+				//printf("RESET\n");
+			}
+
+			cv::Point2f currentPointPolar = polarTable.Get(greenCenter);
+			innerWheelPoints.Add(greenCenter, currentPointPolar, time);
+			LimitLap(innerWheelPoints);
+			wheelFit.Add(greenCenter);
+
+			int timeAround = GetTimeAround(currentPointPolar.y, polarTable.Get(resetPointGreen).y, time, innerWheelLap);
+			if (timeAround > 0)
+			{
+				AddFinishedPoint(FINISHED_WHEEL, FinishedPoint(currentPointPolar.x, currentPointPolar.y, timeAround, time));
+				//printf("Green time around: %d\n", timeAround);
+				printf("%d,", timeAround);
+			}
+		}
+
+		//Once the 0 has been all the way round, centre the wheel on the circle it traces
+		if (!innerWheelPointsPrevious.IsEmpty() && wheelFit.Solve())
+		{
+			cv::Point2f fitCenter = wheelFit.GetCenter();
+			cv::Point newCenter(cvRound(fitCenter.x), cvRound(fitCenter.y));
+			if (cv::Rect(cv::Point(0, 0), captureSize).contains(newCenter))
+			{
+				wheelCenter = newCenter;
+				PrepareGeometry();
+			}
+		}
+	}
+
+	//Track the ball
+	if(ballCenter.x != -1 && ballCenter.y != -1)
+	{
+		ballMotion.Add(polarTable.Get(ballCenter).y, time);
+
+		//If we don't already have a reset point
+		if (resetPointBall == cv::Point(-1, -1))
+		{
+			resetPointBall = ballCenter;
+		}
+		else
+		{
+			if (!ballPoints.IsEmpty())
+			{
+				ballPointPrevious = ballPoints.Back();
+			}
+
+			if (IsPointBetweenTwoPoints(polarTable, resetPointBall, ballCenter, ballPointPrevious))
+			{
+				ballPointsPrevious.Swap(ballPoints);
+				ballPoints.Clear();
+				ballLap.Build(ballPointsPrevious);
+				//printf("Ball RESET\n");
+			}
+
+			cv::Point2f currentPointPolar = polarTable.Get(ballCenter);
+			ballPoints.Add(ballCenter, currentPointPolar, time);
+			LimitLap(ballPoints);
+
+			float resetAngle = polarTable.Get(resetPointBall).y;
+			int timeAround = GetTimeAround(currentPointPolar.y, resetAngle, time, ballLap);
+
+			if (timeAround > 0)
+			{
+				AddFinishedPoint(FINISHED_BALL, FinishedPoint(currentPointPolar.x, currentPointPolar.y, timeAround, time));
+				//printf("Ball time around: %d\n", timeAround);
+				//printf("%d,", timeAround);
+			}
+
+			if (GetEstimatedRadiusDifference(currentPointPolar, resetAngle, ballLap) > 5.f)
+			{
+				ballPointsRadiusDecay.Add(ballCenter, currentPointPolar, time);
+				LimitLap(ballPointsRadiusDecay);
+			}
+		}
+	}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "AngularMotionFit.h"
+#include "CircleFit.h"
+#include "Clock.h"
+#include "LapTable.h"
+#include "PolarTable.h"
+#include "RingBuffer.h"
+#include "TrackStore.h"
+
+enum FinishedPointKind
+{
+	FINISHED_WHEEL,
+	FINISHED_BALL
+};
+
+struct FinishedPoint
+{
+	float radius;
+	float angle;
+	int timeAround;
+	Timestamp time;
+
+	FinishedPoint()
+	{
+		radius = 0;
+		angle = 0;
+		timeAround = 0;
+	}
+
+	FinishedPoint(float r, float a, int tA, Timestamp t)
+	{
+		radius = r;
+		angle = a;
+		timeAround = tA;
+		time = t;
+	}
+};
+
+bool IsPointBetweenTwoPoints(const PolarTable& polar, cv::Point point, cv::Point point1, cv::Point point2);
+
+float GetEstimatedRadiusDifference(cv::Point2f pointPolar, float resetAngle, const LapTable& previousLap);
+
+class FinishedPointLog;
+
+//Returns time around in milliseconds
+int GetTimeAround(float angle, float resetAngle, Timestamp time, const LapTable& previousLap);
+
+//Times laps of the green 0 on the rotor and of the ball on the track.
+//Each lap starts when the object passes the point it was first seen at, and every new position is
+//compared against the previous lap at the same angle to get the current time around.
+class SpinTracker
+{
+public:
+	SpinTracker();
+
+	//Forget all laps, reset points and timings
+	void Reset();
+
+	//Hands the finished points still held in memory to the log, if there is one, and forgets them
+	void FlushHistory();
+
+	//Adds this frame's detections, (-1, -1) for anything that wasn't found
+	void Update(cv::Point ballCenter, cv::Point greenCenter, Timestamp time);
+
+	//size of the frames the detections come from, set by the caller
+	cv::Size captureSize;
+	cv::Point wheelCenter;
+	//polar coordinates of every capture pixel around wheelCenter
+	PolarTable polarTable;
+
+	cv::Point greenPointPrevious;
+	cv::Point ballPointPrevious;
+
+	cv::Point resetPointGreen;
+	cv::Point resetPointBall;
+
+	TrackStore innerWheelPoints;
+	TrackStore innerWheelPointsPrevious;
+
+	TrackStore ballPoints;
+	TrackStore ballPointsPrevious;
+	TrackStore ballPointsRadiusDecay;
+
+	//the most recent timings, older ones go to the log
+	RingBuffer<FinishedPoint> ballSpeeds;
+	RingBuffer<FinishedPoint> wheelSpeeds;
+	//all timings since the start, including the ones no longer held
+	long long ballSpeedCount;
+	long long wheelSpeedCount;
+
+	//circle traced by the green 0, which wheelCenter follows
+	CircleFit wheelFit;
+
+	//the ball's angular velocity and deceleration, updated with every sighting rather than once a lap
+	AngularMotionFit ballMotion;
+
+	//where timings go once they drop out of the ring buffers, null to just forget them
+	FinishedPointLog* finishedPointLog;
+
+	//the previous laps sorted by angle, for the time around and radius lookups
+	LapTable innerWheelLap;
+	LapTable ballLap;
+
+private:
+	void AddFinishedPoint(FinishedPointKind kind, const FinishedPoint& point);
+	//Stops a lap that never rolls over (e.g. the reset point is never passed again) from growing forever
+	void LimitLap(TrackStore& points);
+
+	//time of the latest update, for the log's reset markers
+	Timestamp lastTime;
+
+	//Keeps the polar table centred on the wheel, and the laps sorted around the same centre
+	void PrepareGeometry();
+};
@@ -0,0 +1,51 @@
+#include "TrackStore.h"
+
+#include <algorithm>
+
+void TrackStore::Clear()
+{
+	x.clear();
+	y.clear();
+	radius.clear();
+	angle.clear();
+	time.clear();
+}
+
+void TrackStore::Add(cv::Point point, cv::Point2f polar, Timestamp time)
+{
+	x.push_back(point.x);
+	y.push_back(point.y);
+	radius.push_back(polar.x);
+	angle.push_back(polar.y);
+	this->time.push_back(time);
+}
+
+void TrackStore::UpdatePolar(const PolarTable& polar)
+{
+	for (int i = 0; i < Size(); i++)
+	{
+		cv::Point2f pointPolar = polar.Get(GetPoint(i));
+		radius[i] = pointPolar.x;
+		angle[i] = pointPolar.y;
+	}
+}
+
+void TrackStore::Swap(TrackStore& other)
+{
+	x.swap(other.x);
+	y.swap(other.y);
+	radius.swap(other.radius);
+	angle.swap(other.angle);
+	time.swap(other.time);
+}
+
+void TrackStore::DropOldest(int count)
+{
+	count = std::min(count, Size());
+
+	x.erase(x.begin(), x.begin() + count);
+	y.erase(y.begin(), y.begin() + count);
+	radius.erase(radius.begin(), radius.begin() + count);
+	angle.erase(angle.begin(), angle.begin() + count);
+	time.erase(time.begin(), time.begin() + count);
+}
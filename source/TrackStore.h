@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "Clock.h"
+#include "PolarTable.h"
+
+//The positions of a tracked object over a lap, one array per field so a scan over any one field is contiguous.
+//Polar coordinates around the wheel centre are worked out once, when a point is added.
+class TrackStore
+{
+public:
+	void Clear();
+	void Add(cv::Point point, cv::Point2f polar, Timestamp time);
+	//Recomputes the polar coordinates after the wheel centre moved
+	void UpdatePolar(const PolarTable& polar);
+	//Exchanges contents with other, keeping both sets of buffers
+	void Swap(TrackStore& other);
+	//Forgets the first count points
+	void DropOldest(int count);
+
+	int Size() const { return (int)x.size(); }
+	bool IsEmpty() const { return x.empty(); }
+	cv::Point GetPoint(int index) const { return cv::Point(x[index], y[index]); }
+	cv::Point Back() const { return GetPoint(Size() - 1); }
+
+	std::vector<int> x;
+	std::vector<int> y;
+	std::vector<float> radius;
+	std::vector<float> angle;
+	std::vector<Timestamp> time;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+
+//Switches shared between the presentation thread, which changes them from the keyboard,
+//and the tracking thread, which reads them once per frame
+struct TrackerControls
+{
+	//this can be toggled with 't'
+	std::atomic<bool> trackingEnabled;
+	//this can be toggled with 's'
+	std::atomic<bool> spinTrack;
+	//this can be toggled with 'd'
+	std::atomic<bool> debugMode;
+	//this can be toggled with 'g'
+	std::atomic<bool> greenDebug;
+	//radius of the circle masked out of the gray images, changed with 'm' and 'n'
+	std::atomic<int> greenMaskRadius;
+	//set by 'r', cleared by the tracker once the laps have been thrown away
+	std::atomic<bool> resetRequested;
+	//set by 'esc'
+	std::atomic<bool> quit;
+
+	TrackerControls(bool trackingEnabled, bool spinTrack)
+		: trackingEnabled(trackingEnabled), spinTrack(spinTrack), debugMode(false), greenDebug(false),
+		  greenMaskRadius(100), resetRequested(false), quit(false)
+	{
+	}
+};
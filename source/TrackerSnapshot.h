@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "Clock.h"
+#include "LandingDistribution.h"
+#include "PocketPredictor.h"
+
+//Everything the presentation thread needs to draw one frame, copied out of the tracker so that
+//drawing never touches state the tracking thread is updating
+struct TrackerSnapshot
+{
+	const static int LIKELY_POCKETS = 3;
+
+	cv::Mat frame;
+	int frameIndex;
+	Timestamp time;
+
+	bool trackingEnabled;
+	bool spinTrack;
+	int greenMaskRadius;
+
+	//(-1, -1) when not found
+	cv::Point ballCenter;
+	cv::Point greenCenter;
+
+	cv::Point wheelCenter;
+	//from the rotor ring's shift between frames, in degrees per second
+	bool rotorVelocityValid;
+	float rotorAngularVelocity;
+	//from the fit over the latest ball sightings, in degrees per second and degrees per second per second
+	bool ballMotionValid;
+	float ballAngularVelocity;
+	float ballDeceleration;
+
+	bool predictionValid;
+	PocketPrediction prediction;
+	//the pockets the landing distribution makes most likely, most likely first
+	int likelyPocketCount;
+	PocketChance likelyPockets[LIKELY_POCKETS];
+	//the pockets the past spins most like this one voted for
+	int empiricalPocketCount;
+	PocketChance empiricalPockets[LIKELY_POCKETS];
+	cv::Point resetPointGreen;
+	cv::Point resetPointBall;
+
+	std::vector<cv::Point> innerWheelPointsPrevious;
+	std::vector<cv::Point> innerWheelPoints;
+	std::vector<cv::Point> ballPointsPrevious;
+	std::vector<cv::Point> ballPoints;
+	std::vector<cv::Point> ballPointsRadiusDecay;
+
+	//intermediate images, only filled in while the matching debug mode is on
+	bool debugImages;
+	cv::Mat differenceImage;
+	cv::Mat thresholdImage;
+	cv::Mat finalThresholdImage;
+
+	bool greenDebugImages;
+	cv::Mat greenImage;
+	cv::Mat differenceImageGreen;
+	cv::Mat finalThresholdImageGreen;
+
+	TrackerSnapshot()
+	{
+		frameIndex = -1;
+		trackingEnabled = false;
+		spinTrack = false;
+		greenMaskRadius = 0;
+		rotorVelocityValid = false;
+		rotorAngularVelocity = 0;
+		ballMotionValid = false;
+		ballAngularVelocity = 0;
+		ballDeceleration = 0;
+		predictionValid = false;
+		likelyPocketCount = 0;
+		empiricalPocketCount = 0;
+		debugImages = false;
+		greenDebugImages = false;
+	}
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+
+//Lock-free single producer / single consumer handoff of the most recent value.
+//The writer always has a slot of its own to fill, the reader always gets the newest published slot,
+//and values the reader was too slow for are simply overwritten. Slots are reused, never reallocated,
+//so buffers inside T (cv::Mat, std::vector) keep their storage from one handoff to the next.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+		: sharedSlot(1)
+	{
+		writeSlot = 0;
+		readSlot = 2;
+	}
+
+	//Writer side: the slot to fill before calling Publish
+	T& GetWriteSlot()
+	{
+		return slots[writeSlot];
+	}
+
+	//Hands the filled slot to the reader. Returns true if this replaced a value the reader never took.
+	bool Publish()
+	{
+		int previousShared = sharedSlot.exchange(writeSlot | FRESH_VALUE, std::memory_order_acq_rel);
+		writeSlot = previousShared & SLOT_MASK;
+		return (previousShared & FRESH_VALUE) != 0;
+	}
+
+	//Reader side: whether something newer than the read slot has been published
+	bool HasFreshValue() const
+	{
+		return (sharedSlot.load(std::memory_order_acquire) & FRESH_VALUE) != 0;
+	}
+
+	//Swaps the newest published value into the read slot. Returns false if there was nothing new.
+	bool Acquire()
+	{
+		if (!HasFreshValue())
+		{
+			return false;
+		}
+
+		int previousShared = sharedSlot.exchange(readSlot, std::memory_order_acq_rel);
+		readSlot = previousShared & SLOT_MASK;
+		return true;
+	}
+
+	T& GetReadSlot()
+	{
+		return slots[readSlot];
+	}
+
+private:
+	//The shared slot index lives in the low bits, the high bit marks a value the reader hasn't taken yet
+	static const int FRESH_VALUE = 4;
+	static const int SLOT_MASK = 3;
+
+	T slots[3];
+	int writeSlot;
+	int readSlot;
+	std::atomic<int> sharedSlot;
+};
@@ -0,0 +1,315 @@
+#include "WheelFit.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/core/core.hpp>
+
+#ifndef M_PI
+	#define M_PI 3.14159265358979323846
+#endif
+
+const static double GRAVITY = 9.81;
+//Fewest timings in the rim a spin needs to be worth fitting
+const static int MIN_LAPS = 10;
+//The ball is in the rim while it is at least this share of the spin's rim radius out from the centre
+const static float RIM_RADIUS_SHARE = 0.97f;
+//Timings below the rim after the last one in it, for a spin to count as having shown where the ball left
+const static int MIN_DROPPED_LAPS = 3;
+//Below this the air drag is left out of the closed form, which would otherwise divide by it
+const static double MIN_DRAG = 1e-12;
+const static int MAX_START_SPEED_ITERATIONS = 50;
+const static int MAX_ITERATIONS = 100;
+//Step for the Jacobian, in the logarithms of the constants
+const static double JACOBIAN_STEP = 1e-6;
+
+//Angle covered after elapsed seconds from startSpeed, slowing by friction + drag * speed^2, and its derivative
+//with respect to startSpeed. Once the ball has stopped the angle stays where it stopped.
+static double AngleAfter(double elapsed, double startSpeed, double friction, double drag, double& derivative)
+{
+	if (drag < MIN_DRAG)
+	{
+		double stopTime = startSpeed / friction;
+		double time = std::min(elapsed, stopTime);
+		derivative = time;
+		return startSpeed * time - friction * time * time / 2;
+	}
+
+	double rate = std::sqrt(friction * drag);
+	double scale = std::sqrt(drag / friction);
+	double startPhase = std::atan(startSpeed * scale);
+	double phase = startPhase - rate * std::min(elapsed, startPhase / rate);
+
+	derivative = (std::tan(startPhase) - std::tan(phase)) / drag * scale / (1 + startSpeed * startSpeed * scale * scale);
+	return std::log(std::cos(phase) / std::cos(startPhase)) / drag;
+}
+
+static double SpeedAfter(double elapsed, double startSpeed, double friction, double drag)
+{
+	if (drag < MIN_DRAG)
+	{
+		return std::max(startSpeed - friction * elapsed, 0.0);
+	}
+
+	double rate = std::sqrt(friction * drag);
+	double startPhase = std::atan(startSpeed * std::sqrt(drag / friction));
+	return std::sqrt(friction / drag) * std::tan(std::max(startPhase - rate * elapsed, 0.0));
+}
+
+//Solves the start speed of a range of spins for one rolling friction and air drag, and fills in their residuals
+class WheelFit::SpinResiduals : public cv::ParallelLoopBody
+{
+public:
+	Spin* spins;
+	const int* offsets;
+	double* residuals;
+	double friction;
+	double drag;
+
+	void operator()(const cv::Range& range) const override
+	{
+		for (int index = range.start; index < range.end; index++)
+		{
+			Spin& spin = spins[index];
+			double* spinResiduals = residuals + offsets[index];
+			int laps = (int)spin.ends.size();
+
+			//Gauss-Newton on the one unknown, starting from the average speed of the first lap
+			double speed = 2 * M_PI / spin.seconds[0];
+			for (int iteration = 0; iteration < MAX_START_SPEED_ITERATIONS; iteration++)
+			{
+				double product = 0;
+				double squared = 0;
+				for (int lap = 0; lap < laps; lap++)
+				{
+					double endDerivative, startDerivative;
+					double end = AngleAfter(spin.ends[lap], speed, friction, drag, endDerivative);
+					double start = AngleAfter(spin.ends[lap] - spin.seconds[lap], speed, friction, drag, startDerivative);
+					double slope = endDerivative - startDerivative;
+					product += slope * (end - start - 2 * M_PI);
+					squared += slope * slope;
+				}
+				if (squared <= 0)
+				{
+					break;
+				}
+
+				double step = -product / squared;
+				//At most halve or double it each step, so a poor first guess can't throw it below zero
+				double next = std::min(std::max(speed + step, speed / 2), speed * 2);
+				bool converged = std::fabs(next - speed) < 1e-12 * speed;
+				speed = next;
+				if (converged)
+				{
+					break;
+				}
+			}
+
+			spin.startSpeed = speed;
+			for (int lap = 0; lap < laps; lap++)
+			{
+				double derivative;
+				double end = AngleAfter(spin.ends[lap], speed, friction, drag, derivative);
+				double start = AngleAfter(spin.ends[lap] - spin.seconds[lap], speed, friction, drag, derivative);
+				spinResiduals[lap] = end - start - 2 * M_PI;
+			}
+		}
+	}
+};
+
+WheelFit::WheelFit(const std::vector<RecordedSpin>& recordedSpins)
+{
+	lapCount = 0;
+	rmsError = 0;
+	leaveCount = 0;
+
+	std::vector<float> radii;
+	for (const RecordedSpin& recorded : recordedSpins)
+	{
+		const std::vector<BallLap>& laps = recorded.laps;
+		if ((int)laps.size() < MIN_LAPS)
+		{
+			continue;
+		}
+
+		//The rim is where the ball spends most of the spin, so well up the spread of its radii
+		radii.clear();
+		for (const BallLap& lap : laps)
+		{
+			radii.push_back(lap.radius);
+		}
+		std::nth_element(radii.begin(), radii.begin() + radii.size() * 9 / 10, radii.end());
+		float rimRadius = radii[radii.size() * 9 / 10];
+
+		int lastInRim = -1;
+		for (int i = 0; i < (int)laps.size(); i++)
+		{
+			if (laps[i].radius >= RIM_RADIUS_SHARE * rimRadius)
+			{
+				lastInRim = i;
+			}
+		}
+
+		double startTime = laps[0].time - laps[0].seconds;
+		for (int i = 0; i <= lastInRim; i++)
+		{
+			startTime = std::min(startTime, laps[i].time - laps[i].seconds);
+		}
+
+		Spin spin;
+		for (int i = 0; i <= lastInRim; i++)
+		{
+			if (laps[i].seconds > 0)
+			{
+				spin.ends.push_back(laps[i].time - startTime);
+				spin.seconds.push_back(laps[i].seconds);
+			}
+		}
+		if ((int)spin.ends.size() < MIN_LAPS)
+		{
+			continue;
+		}
+
+		spin.leaveTime = (int)laps.size() - 1 - lastInRim >= MIN_DROPPED_LAPS ? laps[lastInRim].time - startTime : 0;
+		spin.startSpeed = 0;
+
+		offsets.push_back(lapCount);
+		lapCount += (int)spin.ends.size();
+		spins.push_back(spin);
+	}
+}
+
+double WheelFit::Evaluate(double rollingFriction, double airDrag, std::vector<double>& residuals)
+{
+	residuals.resize(lapCount);
+
+	SpinResiduals body;
+	body.spins = spins.data();
+	body.offsets = offsets.data();
+	body.residuals = residuals.data();
+	body.friction = rollingFriction;
+	body.drag = airDrag;
+	cv::parallel_for_(cv::Range(0, (int)spins.size()), body);
+
+	double sum = 0;
+	for (double residual : residuals)
+	{
+		sum += residual * residual;
+	}
+	return sum;
+}
+
+bool WheelFit::Fit(WheelConstants& constants)
+{
+	if (spins.empty())
+	{
+		return false;
+	}
+
+	//Fitted as logarithms, so neither can go negative
+	double parameters[2] = { std::log(std::max(constants.rollingFriction, 1e-6)), std::log(std::max(constants.airDrag, 1e-9)) };
+
+	std::vector<double> residuals, stepped, trial;
+	std::vector<double> jacobian[2];
+	double cost = Evaluate(std::exp(parameters[0]), std::exp(parameters[1]), residuals);
+	double damping = 1e-3;
+
+	for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+	{
+		for (int column = 0; column < 2; column++)
+		{
+			double shifted[2] = { parameters[0], parameters[1] };
+			shifted[column] += JACOBIAN_STEP;
+			Evaluate(std::exp(shifted[0]), std::exp(shifted[1]), stepped);
+
+			jacobian[column].resize(lapCount);
+			for (int i = 0; i < lapCount; i++)
+			{
+				jacobian[column][i] = (stepped[i] - residuals[i]) / JACOBIAN_STEP;
+			}
+		}
+
+		double normal[2][2] = { { 0, 0 }, { 0, 0 } };
+		double gradient[2] = { 0, 0 };
+		for (int i = 0; i < lapCount; i++)
+		{
+			for (int row = 0; row < 2; row++)
+			{
+				gradient[row] += jacobian[row][i] * residuals[i];
+				for (int column = 0; column < 2; column++)
+				{
+					normal[row][column] += jacobian[row][i] * jacobian[column][i];
+				}
+			}
+		}
+
+		//Raise the damping until a step makes the fit better, or give up once the steps are too small to matter
+		bool improved = false;
+		double step[2] = { 0, 0 };
+		while (!improved && damping < 1e10)
+		{
+			double a = normal[0][0] * (1 + damping);
+			double b = normal[0][1];
+			double d = normal[1][1] * (1 + damping);
+			double determinant = a * d - b * b;
+			if (determinant <= 0)
+			{
+				damping *= 10;
+				continue;
+			}
+
+			step[0] = -(d * gradient[0] - b * gradient[1]) / determinant;
+			step[1] = -(a * gradient[1] - b * gradient[0]) / determinant;
+
+			double trialCost = Evaluate(std::exp(parameters[0] + step[0]), std::exp(parameters[1] + step[1]), trial);
+			if (trialCost < cost)
+			{
+				parameters[0] += step[0];
+				parameters[1] += step[1];
+				bool converged = cost - trialCost < 1e-12 * cost;
+				cost = trialCost;
+				residuals.swap(trial);
+				damping = std::max(damping / 10, 1e-12);
+				improved = true;
+				if (converged)
+				{
+					damping = 1e10;
+				}
+			}
+			else
+			{
+				damping *= 10;
+			}
+		}
+
+		if (!improved || damping >= 1e10 || std::fabs(step[0]) + std::fabs(step[1]) < 1e-10)
+		{
+			break;
+		}
+	}
+
+	constants.rollingFriction = std::exp(parameters[0]);
+	constants.airDrag = std::exp(parameters[1]);
+
+	//The spins' start speeds belong to the last trial, put them back to the best fit's
+	cost = Evaluate(constants.rollingFriction, constants.airDrag, residuals);
+	rmsError = std::sqrt(cost / lapCount) * 180 / M_PI;
+
+	std::vector<double> leaveSpeeds;
+	for (const Spin& spin : spins)
+	{
+		if (spin.leaveTime > 0)
+		{
+			leaveSpeeds.push_back(SpeedAfter(spin.leaveTime, spin.startSpeed, constants.rollingFriction, constants.airDrag));
+		}
+	}
+	leaveCount = (int)leaveSpeeds.size();
+	if (leaveCount > 0)
+	{
+		std::nth_element(leaveSpeeds.begin(), leaveSpeeds.begin() + leaveCount / 2, leaveSpeeds.end());
+		double leaveSpeed = leaveSpeeds[leaveCount / 2];
+		constants.statorIncline = std::atan(leaveSpeed * leaveSpeed * constants.rimRadius / GRAVITY);
+	}
+
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "BallTrajectory.h"
+#include "SpinHistory.h"
+
+//Fits BallTrajectory's constants for one wheel to recorded spins. While the ball is in the rim it slows by
+//rollingFriction + airDrag * speed^2, which integrates to a closed form for the angle covered since the start of
+//the spin. Every ball timing then says that angle grew by a full turn over the lap it timed. Levenberg-Marquardt
+//finds the rolling friction and air drag that best agree with all the timings of all the spins. The spins'
+//starting speeds are solved for again at every step, spin by spin, in parallel.
+//The ball leaves the rim at sqrt(g tan(incline) / rimRadius), so the speed the fit gives where each spin's ball
+//dropped off the rim also gives the stator incline.
+class WheelFit
+{
+public:
+	//Keeps the laps of each spin that were timed while the ball was still in the rim
+	explicit WheelFit(const std::vector<RecordedSpin>& spins);
+
+	//Spins and laps with enough timings in the rim to fit
+	int GetSpinCount() const { return (int)spins.size(); }
+	int GetLapCount() const { return lapCount; }
+
+	//Starts from and fills in constants' rollingFriction and airDrag, and statorIncline if any spin showed where its
+	//ball left the rim. The lengths aren't fitted, the timings are in pixels. Returns false if there was nothing to fit.
+	bool Fit(WheelConstants& constants);
+
+	//Root mean square of the fitted angles' errors over all the laps, in degrees
+	double GetRmsError() const { return rmsError; }
+
+	//How many spins the stator incline was worked out from
+	int GetLeaveCount() const { return leaveCount; }
+
+private:
+	struct Spin
+	{
+		//lap end times and lap times, relative to when the first lap started
+		std::vector<double> ends;
+		std::vector<double> seconds;
+		//seconds from when the first lap started to the last timing in the rim, 0 if the ball never left it
+		double leaveTime;
+		//fitted speed in radians per second when the first lap started
+		double startSpeed;
+	};
+
+	class SpinResiduals;
+
+	//Fills residuals (radians, in spin order) for rolling friction and air drag, solving each spin's start speed.
+	//Returns the sum of squares.
+	double Evaluate(double rollingFriction, double airDrag, std::vector<double>& residuals);
+
+	std::vector<Spin> spins;
+	//where each spin's residuals start
+	std::vector<int> offsets;
+	int lapCount;
+	double rmsError;
+	int leaveCount;
+};
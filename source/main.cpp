@@ -1,47 +1,43 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <memory>
+#include <thread>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
-#include <Windows.h>
 #include <chrono>
 
-#ifndef M_PI
-	#define M_PI 3.14159265358979323846
-#endif
+#include "AllocationCounter.h"
+#include "AnnulusSpans.h"
+#include "AsyncFrameSource.h"
+#include "BlobFinder.h"
+#include "Clock.h"
+#include "ColourMask.h"
+#include "EmpiricalPredictor.h"
+#include "FinishedPointLog.h"
+#include "FrameSource.h"
+#include "LandingDistribution.h"
+#include "MappedFrameSource.h"
+#include "MotionMask.h"
+#include "Options.h"
+#include "PocketPredictor.h"
+#include "PolarStrip.h"
+#include "Presentation.h"
+#include "RecordingFrameSource.h"
+#include "RotorPhase.h"
+#include "SearchWindow.h"
+#include "SpinIndex.h"
+#include "SpinTracker.h"
+#include "TrackerControls.h"
+#include "TrackerSnapshot.h"
+#include "TripleBuffer.h"
 
 using namespace std;
 using namespace cv;
 
-struct RouPoint
-{
-	cv::Point point;
-	std::chrono::steady_clock::time_point time;
-
-	RouPoint(cv::Point p)
-	{
-		point = p;
-	}
-};
-
-struct FinishedPoint
-{
-	float radius;
-	float angle;
-	int timeAround;
-	std::chrono::steady_clock::time_point time;
-
-	FinishedPoint(float r, float a, int tA, std::chrono::steady_clock::time_point t)
-	{
-		radius = r;
-		angle = a;
-		timeAround = tA;
-		time = t;
-	}
-};
-
 //*******************************************************************************//
 //Motion tracking code modified from https://www.youtube.com/watch?v=X6rPdRZzgjg //
 //*******************************************************************************//
@@ -52,367 +48,89 @@ const static int SENSITIVITY_VALUE = 40;
 const static int SENSITIVITY_VALUE_GREEN = 80;
 //size of blur used to smooth the intensity image output from absdiff() function
 const static int BLUR_SIZE = 10;
-
-int referenceWindowLeft = 0;
-int referenceWindowTop = 0;
-int referenceWindowWidth = 0;
-int referenceWindowHeight = 0;
-
-int greenMaskRadius = 100;
+//how often the tracker hands a snapshot to the display thread
+const static double DISPLAY_RATE = 30.0;
 
 int rouletteOrder[37] = { 0, 23, 6, 35, 4, 19, 10, 31, 16, 27, 18, 14, 33, 12, 25, 2, 21, 8, 29, 3, 24, 5, 28, 17, 20, 7, 36, 11, 32, 30, 15, 26, 1, 22, 9, 34, 13 };
 
-cv::Point2f ToPolar(cv::Point center, cv::Point point)
+void searchForMovement(const Mat& thresholdImage, Point& previousPoint, BlobFinder& blobFinder)
 {
-	cv::Point translatedPoint = point - center;
-
-	float radius = sqrtf(powf((float)translatedPoint.x, 2.f) + powf((float)translatedPoint.y, 2.f));
-
-	float angleRadians = atan2f((float)translatedPoint.y, (float)translatedPoint.x);
-	float angleDegrees = (angleRadians + (float)M_PI) * 180 / (float)M_PI;
-
-	return cv::Point2f(radius, angleDegrees);
-}
-
-float GetAngleDifference(float zeroAngle, float angle)
-{
-	return fmodf((angle - zeroAngle + 180.f + 360.f), 360.f) - 180.f;
-}
-
-bool IsPointBetweenTwoPoints(cv::Point center, cv::Point point, cv::Point point1, cv::Point point2)
-{
-	cv::Point2f pointPolar = ToPolar(center, point);
-	cv::Point2f point1Polar = ToPolar(center, point1);
-	cv::Point2f point2Polar = ToPolar(center, point2);
-
-	float anglePoint1 = GetAngleDifference(pointPolar.y, point1Polar.y);
-	float anglePoint2 = GetAngleDifference(pointPolar.y, point2Polar.y);
-	
-	return (anglePoint1 >= 0.f && anglePoint1 < 90.f && anglePoint2 < 0.f && anglePoint2 > -90.f) ||
-		   (anglePoint2 >= 0.f && anglePoint2 < 90.f && anglePoint1 < 0.f && anglePoint1 > -90.f);
-}
-
-Mat hwnd2mat(HWND hwnd)
-{
-	HDC hwindowDC, hwindowCompatibleDC;
-
-	HBITMAP hbwindow;
-	Mat src;
-	BITMAPINFOHEADER  bi;
-
-	hwindowDC = GetDC(hwnd);
-	hwindowCompatibleDC = CreateCompatibleDC(hwindowDC);
-	SetStretchBltMode(hwindowCompatibleDC, COLORONCOLOR);
-
-	RECT windowsize;    // get the height and width of the screen
-	GetClientRect(hwnd, &windowsize);
-
-	int srcwidth = referenceWindowWidth;
-	int srcheight = referenceWindowHeight;
-	int srcWidthOffset = referenceWindowLeft;
-	int srcHeightOffset = referenceWindowTop;
-
-	int width = referenceWindowWidth;
-	int height = referenceWindowHeight;  //change this to whatever size you want to resize to
-
-	src.create(height, width, CV_8UC4);
-
-	// create a bitmap
-	hbwindow = CreateCompatibleBitmap(hwindowDC, width, height);
-	bi.biSize = sizeof(BITMAPINFOHEADER);    //http://msdn.microsoft.com/en-us/library/windows/window/dd183402%28v=vs.85%29.aspx
-	bi.biWidth = width;
-	bi.biHeight = -height;  //this is the line that makes it draw upside down or not
-	bi.biPlanes = 1;
-	bi.biBitCount = 32;
-	bi.biCompression = BI_RGB;
-	bi.biSizeImage = 0;
-	bi.biXPelsPerMeter = 0;
-	bi.biYPelsPerMeter = 0;
-	bi.biClrUsed = 0;
-	bi.biClrImportant = 0;
-
-	// use the previously created device context with the bitmap
-	SelectObject(hwindowCompatibleDC, hbwindow);
-	// copy from the window device context to the bitmap device context
-	StretchBlt(hwindowCompatibleDC, 0, 0, width, height, hwindowDC, srcWidthOffset, srcHeightOffset, srcwidth, srcheight, SRCCOPY); //change SRCCOPY to NOTSRCCOPY for wacky colors !
-	GetDIBits(hwindowCompatibleDC, hbwindow, 0, height, src.data, (BITMAPINFO *)&bi, DIB_RGB_COLORS);  //copy from hwindowCompatibleDC to hbwindow
-
-	// avoid memory leak
-	DeleteObject(hbwindow);
-	DeleteDC(hwindowCompatibleDC);
-	ReleaseDC(hwnd, hwindowDC);
-
-	return src;
-}
-
-//int to string helper function
-string intToString(int number)
-{
-	//this function has a number input and string output
-	std::stringstream ss;
-	ss << number;
-	return ss.str();
-}
-
-void placeCrosshair(Mat &cameraFeed, Point position)
-{
-	//make some temp x and y variables so we dont have to type out so much
-	int x = position.x;
-	int y = position.y;
-
-	//draw some crosshairs around the object
-	cv::circle(cameraFeed, Point(x, y), 20, Scalar(0, 255, 0), 2);
-	cv::line(cameraFeed, Point(x, y), Point(x, y - 25), Scalar(0, 255, 0), 2);
-	cv::line(cameraFeed, Point(x, y), Point(x, y + 25), Scalar(0, 255, 0), 2);
-	cv::line(cameraFeed, Point(x, y), Point(x - 25, y), Scalar(0, 255, 0), 2);
-	cv::line(cameraFeed, Point(x, y), Point(x + 25, y), Scalar(0, 255, 0), 2);
-
-	//write the position of the object to the screen
-	cv::putText(cameraFeed, "Tracking object at (" + intToString(x) + "," + intToString(y) + ")", Point(x, y), 1, 1, Scalar(255, 0, 0), 2);
-}
-
-float GetEstimatedRadiusDifference(cv::Point wheelCenter, cv::Point resetPoint, cv::Point point, const std::vector<RouPoint>& pointsVector)
-{
-	float radiusDifference = 0;
-
-	if (pointsVector.empty())
+	//notice how we use the '&' operator for previousPoint. This is because we wish
+	//to take the values passed into the function and manipulate them, rather than just working with a copy.
+	Blob blob;
+	if (blobFinder.FindLargest(thresholdImage, blob))
 	{
-		return radiusDifference;
-	}
-
-	cv::Point2f pointPolar = ToPolar(wheelCenter, point);
-
-	//Find the nearest point in both directions in the previous list
-	const RouPoint* nearestPointPos = nullptr;
-	float nearestDistPos = 360.f;
-
-	const RouPoint* nearestPointNeg = nullptr;
-	float nearestDistNeg = -360.f;
+		//the centre of the largest blob's bounding rectangle
+		//this will be the object's final estimated position.
+		int xpos = blob.boundingBox.x + blob.boundingBox.width / 2;
+		int ypos = blob.boundingBox.y + blob.boundingBox.height / 2;
 
-	cv::Point2f resetPointPolar = ToPolar(wheelCenter, resetPoint);
-	float distanceToReset = GetAngleDifference(pointPolar.y, resetPointPolar.y);
-	if (distanceToReset > 0)
-	{
-		nearestDistPos = distanceToReset;
+		//update the objects positions by changing the 'theObject' array values
+		previousPoint.x = xpos, previousPoint.y = ypos;
 	}
 	else
 	{
-		nearestDistNeg = distanceToReset;
-	}
-
-	for (const RouPoint& p : pointsVector)
-	{
-		cv::Point2f pPolar = ToPolar(wheelCenter, p.point);
-
-		float distance = GetAngleDifference(pointPolar.y, pPolar.y);
-
-		if (distance >= 0 && distance < nearestDistPos)
-		{
-			nearestDistPos = distance;
-			nearestPointPos = &p;
-		}
-
-		if (distance <= 0 && distance > nearestDistNeg)
-		{
-			nearestDistNeg = distance;
-			nearestPointNeg = &p;
-		}
-	}
-
-	//Interpolate between the two points' radii based on their distance to the current point to find the estimated radius of the current point
-	if (nearestPointNeg != nullptr && nearestPointPos != nullptr)
-	{
-		//Set it up such that distNeg = 0, distPos = 1.0, and 0 < distCurrent < 1.0
-		float distCurrent = -nearestDistNeg;
-		float distPos = nearestDistPos - nearestDistNeg;
-
-		distCurrent = distPos == 0 ? 0 : distCurrent / distPos;
-
-		//Linearly interpolate between the time at the negative point and the time at the positive point
-		float negativePointRadius = ToPolar(wheelCenter, nearestPointNeg->point).x;
-		float positivePointRadius = ToPolar(wheelCenter, nearestPointPos->point).x;
-
-		float distCurrentInverse = 1.f - distCurrent;
-		float projectedNearestPointRadius = distCurrentInverse * negativePointRadius + distCurrent * positivePointRadius;
-
-		radiusDifference = std::fabsf(projectedNearestPointRadius - pointPolar.x);
-	}
-	else if (nearestPointNeg != nullptr)
-	{
-		radiusDifference = std::fabsf(ToPolar(wheelCenter, nearestPointNeg->point).x - pointPolar.x);
-	}
-	else if (nearestPointPos != nullptr)
-	{
-		radiusDifference = std::fabsf(ToPolar(wheelCenter, nearestPointPos->point).x - pointPolar.x);
+		previousPoint.x = -1, previousPoint.y = -1;
 	}
-	
-	return radiusDifference;
 }
 
-//Returns time around in milliseconds
-int GetTimeAround(cv::Point wheelCenter, cv::Point resetPoint, const RouPoint& currentPoint, const std::vector<RouPoint>& oldPointVector)
+//Same as searchForMovement for a strip of a ring, where the largest blob is the largest run of columns
+static void searchForPeak(const Mat& binaryStrip, Point& previousPoint, PolarStrip& strip)
 {
-	int timeAround = -1;
-
-	if (oldPointVector.empty())
+	cv::Point2f polar;
+	if (strip.FindPeak(binaryStrip, polar))
 	{
-		return timeAround;
-	}
-
-	cv::Point2f currentPointPolar = ToPolar(wheelCenter, currentPoint.point);
-
-	//Find the nearest point in both directions in the previous list
-	const RouPoint* nearestPointPos = nullptr;
-	float nearestDistPos = 360.f;
-
-	const RouPoint* nearestPointNeg = nullptr;
-	float nearestDistNeg = -360.f;
-
-	cv::Point2f resetPointPolar = ToPolar(wheelCenter, resetPoint);
-	float distanceToReset = GetAngleDifference(currentPointPolar.y, resetPointPolar.y);
-	if (distanceToReset > 0)
-	{
-		nearestDistPos = distanceToReset;
+		previousPoint = strip.ToImage(polar);
 	}
 	else
 	{
-		nearestDistNeg = distanceToReset;
-	}
-
-	for (const RouPoint& p : oldPointVector)
-	{
-		cv::Point2f pPolar = ToPolar(wheelCenter, p.point);
-
-		float distance = GetAngleDifference(currentPointPolar.y, pPolar.y);
-
-		if (distance >= 0 && distance < nearestDistPos)
-		{
-			nearestDistPos = distance;
-			nearestPointPos = &p;
-		}
-
-		if (distance <= 0 && distance > nearestDistNeg)
-		{
-			nearestDistNeg = distance;
-			nearestPointNeg = &p;
-		}
-	}
-
-	//Interpolate between the two points' times based on their distance to the current point
-	if (nearestPointNeg != nullptr && nearestPointPos != nullptr)
-	{
-		//Set it up such that distNeg = 0, distPos = 1.0, and 0 < distCurrent < 1.0
-		float distCurrent = -nearestDistNeg;
-		float distPos = nearestDistPos - nearestDistNeg;
-
-		distCurrent = distPos == 0 ? 0 : distCurrent / distPos;
-
-		//Linearly interpolate between the time at the negative point and the time at the positive point
-		auto negativePointTime = std::chrono::duration_cast<std::chrono::milliseconds>(nearestPointNeg->time.time_since_epoch()).count();
-		auto positivePointTime = std::chrono::duration_cast<std::chrono::milliseconds>(nearestPointPos->time.time_since_epoch()).count();
-
-		float distCurrentInverse = 1.f - distCurrent;
-		int projectedNearestPointTime = (int)(distCurrentInverse * negativePointTime + distCurrent * positivePointTime);
-
-		timeAround = (int)std::chrono::duration_cast<std::chrono::milliseconds>(currentPoint.time.time_since_epoch()).count() - projectedNearestPointTime;
+		previousPoint.x = -1, previousPoint.y = -1;
 	}
-	//else if (nearestPointNeg != nullptr)
-	//{
-	//	timeAround = (int)std::chrono::duration_cast<std::chrono::milliseconds>(currentPoint.time - nearestPointNeg->time).count();
-	//}
-	//else if (nearestPointPos != nullptr)
-	//{
-	//	timeAround = (int)std::chrono::duration_cast<std::chrono::milliseconds>(currentPoint.time - nearestPointPos->time).count();
-	//}
-	
-	return timeAround;
 }
 
-void searchForMovement(Mat thresholdImage, Mat &cameraFeed, Point& previousPoint)
+//Lap times are only as good as the frames the 0 was seen in, which puts them out by a couple of percent
+const static float LAP_VELOCITY_ERROR = 0.02f;
+
+//Rotor speed in degrees per second and its variance, from the phase correlation if it has one,
+//otherwise from the latest lap of the 0
+static bool GetRotorVelocity(const SpinTracker& spinTracker, const RotorPhase& rotorPhase, float& rotorVelocity, float& rotorVelocityVariance)
 {
-	//notice how we use the '&' operator for objectDetected and cameraFeed. This is because we wish
-	//to take the values passed into the function and manipulate them, rather than just working with a copy.
-	//eg. we draw to the cameraFeed to be displayed in the main() function.
-	bool objectDetected = false;
-	Mat temp;
-	thresholdImage.copyTo(temp);
-	//these two vectors needed for output of findContours
-	vector<vector<Point>> contours;
-	vector<Vec4i> hierarchy;
-	//find contours of filtered image using openCV findContours function
-	//findContours(temp,contours,hierarchy,CV_RETR_CCOMP,CV_CHAIN_APPROX_SIMPLE );// retrieves all contours
-	findContours(temp, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0));// retrieves external contours
-
-	if (contours.size() > 0)
-	{
-		objectDetected = true;
-	}
-	else
+	if (rotorPhase.HasVelocity())
 	{
-		objectDetected = false;
+		rotorVelocity = rotorPhase.GetAngularVelocity();
+		rotorVelocityVariance = rotorPhase.GetVelocityVariance();
+		return true;
 	}
 
-	if (objectDetected)
+	const TrackStore& points = spinTracker.innerWheelPoints;
+	if (spinTracker.wheelSpeeds.Size() == 0 || points.Size() < 2 || spinTracker.wheelSpeeds.Back().timeAround <= 0)
 	{
-		//the largest contour is found at the end of the contours vector
-		vector<Point> contour;
-		contour = contours.at(contours.size() - 1);
-
-		//make a bounding rectangle around the largest contour then find its center
-		//this will be the object's final estimated position.
-		Rect objectBoundingRectangle = boundingRect(contour);
-		int xpos = objectBoundingRectangle.x + objectBoundingRectangle.width / 2;
-		int ypos = objectBoundingRectangle.y + objectBoundingRectangle.height / 2;
-
-		//update the objects positions by changing the 'theObject' array values
-		previousPoint.x = xpos, previousPoint.y = ypos;
-	}
-	else
-	{
-		previousPoint.x = -1, previousPoint.y = -1;
+		return false;
 	}
 
-	if (previousPoint.x != -1 && previousPoint.y != -1)
-	{
-		placeCrosshair(cameraFeed, previousPoint);
-	}
+	//A lap time only gives the speed, the last two sightings of the 0 give the direction
+	float direction = GetAngleDifference(points.angle[points.Size() - 2], points.angle[points.Size() - 1]) < 0 ? -1.f : 1.f;
+	rotorVelocity = direction * 360000.f / spinTracker.wheelSpeeds.Back().timeAround;
+	rotorVelocityVariance = (rotorVelocity * LAP_VELOCITY_ERROR) * (rotorVelocity * LAP_VELOCITY_ERROR);
+	return true;
 }
 
-int main()
+static void CopyPoints(const TrackStore& points, std::vector<cv::Point>& destination)
 {
-	namedWindow("ReferenceFrame", WINDOW_NORMAL);
-
-	HWND referenceWindowHandle = FindWindow(0, "ReferenceFrame");
-	if (referenceWindowHandle == nullptr)
+	destination.resize(points.Size());
+	for (int i = 0; i < points.Size(); i++)
 	{
-		printf("Couldn't find reference window handle!");
-		return -1;
+		destination[i] = points.GetPoint(i);
 	}
-	
-	//-Set window to be click-through.
-	LONG lExStyle = GetWindowLong(referenceWindowHandle, GWL_EXSTYLE);
-	lExStyle |=  WS_EX_LAYERED;
-	SetWindowLong(referenceWindowHandle, GWL_EXSTYLE, lExStyle);
-	SetLayeredWindowAttributes(referenceWindowHandle, RGB(255, 0, 0), 0, LWA_COLORKEY);
-
-	Mat transparentImage(1, 1, CV_8UC4);
-	transparentImage = cv::Scalar(0, 0, 255, 255);
-	cv::imshow("ReferenceFrame", transparentImage);
-
-	//some boolean variables for added functionality
-	bool objectDetected = false;
-	//this can be toggled with 'd'
-	bool debugMode = false;
-	//this can be toggled with 't'
-	bool trackingEnabled = false;
-	//this can be toggled with 'g'
-	bool greenDebug = false;
-	//this can be toggled with 's'
-	bool spinTrack = false;
-	//pause and resume code
-	bool pause = false;
+}
 
+//Captures and processes frames until the source runs dry or quit is requested.
+//If snapshots is given, a copy of the tracking state is published to it at most DISPLAY_RATE times a second.
+void RunTracking(FrameSource& frameSource, const Options& options, TrackerControls& controls, TripleBuffer<TrackerSnapshot>* snapshots)
+{
 	//set up the matrices that we will need
+	//the frame handed out by the source
+	Frame frame;
 	//the current frame
 	Mat currentFrame;
 	//their grayscale images (needed for absdiff() function)
@@ -422,6 +140,8 @@ int main()
 	//thresholded difference image (for use in findContours() function)
 	Mat thresholdImage;
 
+	//picks out the green pixels without converting the frame to HSV
+	HsvRangeMask greenRangeMask;
 	//images filtered for green to look for the 0
 	Mat currentGreenImage, previousGreenImage;
 	//resulting difference image
@@ -429,396 +149,738 @@ int main()
 	//thresholded difference image (for use in findContours() function)
 	Mat thresholdImageGreen;
 
-	HWND hwndDesktop = GetDesktopWindow();
+	//blur + threshold stages that keep their buffers between frames
+	BoxThreshold grayBoxThreshold;
+	BoxThreshold greenBoxThreshold;
+
+	//the whole gray path in one pass, used whenever the intermediate images aren't needed
+	FusedMotionMask fusedMotionMask;
+	bool useFusedGray = !options.referenceGray && !options.verifyFused && fusedMotionMask.IsExact();
+	//the fused kernel's own state when checking it against the step by step version
+	Mat verifyPreviousLuma, verifyThresholdImage;
+	int mismatchedFrames = 0;
+	//finds the largest region of each threshold image, keeping its buffers between frames
+	BlobFinder blobFinder;
+
+	//Runs of pixels that the ball and the 0 can be in, rebuilt only when the mask radius or the capture size changes
+	AnnulusSpans ballTrack;
+	AnnulusSpans rotorRing;
+
+	//Polar strips: the ball track and rotor ring unwrapped so the ball and the 0 are peaks along the angle.
+	//The rotor ring's strip is also what the rotor phase is measured from, so it is only unwrapped once a frame.
+	PolarStrip ballStrip;
+	PolarStrip greenStrip;
+	FusedMotionMask stripMotionMask;
+	BoxThreshold greenStripBoxThreshold;
+	Mat ballStripImage, previousBallStripLuma, ballStripMask;
+	Mat greenStripImage, previousGreenStripImage, greenStripMask, previousGreenStripMask, greenStripDifference, greenStripThreshold;
+	//set when a frame didn't go through the strips, so the previous strips have to be redone from previousFrame
+	bool previousStripsStale = false;
+
+	//Rotor speed every frame from the shift of the unwrapped rotor ring in greenStripImage
+	RotorPhase rotorPhase;
+
+	//Which pocket the ball will land in, refreshed every frame
+	PocketPredictor pocketPredictor(rouletteOrder, 37);
+	pocketPredictor.leaveSpeed = options.leaveSpeed;
+	pocketPredictor.dropTime = options.dropTime;
+	pocketPredictor.reversePockets = options.reversePockets;
+	//The ball model's tables are built once here rather than while a spin is being tracked
+	BallTrajectory ballTrajectory(options.wheel);
+	if (options.physics)
+	{
+		if (ballTrajectory.IsValid())
+		{
+			pocketPredictor.trajectory = &ballTrajectory;
+		}
+		else
+		{
+			printf("The wheel constants don't bring the ball down to the deflectors, predicting without the ball model\n");
+		}
+	}
+	PocketPrediction prediction;
+	bool predictionValid = false;
+
+	//How likely each pocket is, from trajectories drawn around the prediction
+	LandingDistribution landingDistribution(pocketPredictor);
+	landingDistribution.sampleCount = options.landingSamples;
+	landingDistribution.timeBudget = options.landingBudget / 1000.0;
+	landingDistribution.deflectorCount = options.deflectorCount;
+	PocketChance likelyPockets[TrackerSnapshot::LIKELY_POCKETS];
+	int likelyPocketCount = 0;
+
+	//The votes of the past spins most like this one, once its ball has slowed to the reference speed
+	SpinIndex spinIndex;
+	bool empiricalPrediction = false;
+	if (!options.spinIndexPath.empty())
+	{
+		if (spinIndex.Open(options.spinIndexPath))
+		{
+			empiricalPrediction = true;
+			printf("Spin index %s holds %d spins\n", options.spinIndexPath.c_str(), spinIndex.GetSize());
+		}
+		else
+		{
+			printf("Couldn't open spin index %s, predicting without past spins\n", options.spinIndexPath.c_str());
+		}
+	}
+	EmpiricalPredictor empiricalPredictor(spinIndex, pocketPredictor);
+	empiricalPredictor.referenceSpeed = options.referenceSpeed;
+	empiricalPredictor.neighbours = options.neighbours;
+	PocketChance empiricalPockets[TrackerSnapshot::LIKELY_POCKETS];
+	int empiricalPocketCount = 0;
+
+	//Predictive search: where the ball and the 0 should be next, and the previous frame to compare those windows against
+	SearchWindow ballSearch;
+	SearchWindow greenSearch;
+	Frame previousFrame;
+	//set once a frame only looked at windows, so the full previous images have to be redone from previousFrame
+	bool previousGrayStale = false;
+	bool previousGreenStale = false;
+	//buffers the window images are views of, so windows of different sizes don't reallocate
+	Mat windowPreviousLumaBuffer, windowThresholdBuffer;
+	Mat windowPreviousGreenBuffer, windowGreenBuffer, windowDifferenceGreenBuffer, windowThresholdGreenBuffer;
 
 	Point ballCenter(-1, -1);
 	Point greenCenter(-1, -1);
-	Point wheelCenter(-1, -1);
-
-	Point greenPointPrevious(-1, -1);
-	Point ballPointPrevious(-1, -1);
-
-	cv::Point resetPointGreen(-1, -1);
-	cv::Point resetPointBall(-1, -1);
 
-	std::vector<RouPoint> innerWheelPoints;
-	std::vector<RouPoint> innerWheelPointsPrevious;
+	SpinTracker spinTracker;
 
-	std::vector<RouPoint> ballPoints;
-	std::vector<RouPoint> ballPointsPrevious;
-	std::vector<RouPoint> ballPointsRadiusDecay;
-
-	std::vector<FinishedPoint> ballSpeeds;
-	std::vector<FinishedPoint> wheelSpeeds;
+	FinishedPointLog finishedPointLog;
+	if (!options.historyLogPath.empty())
+	{
+		if (finishedPointLog.Open(options.historyLogPath))
+		{
+			spinTracker.finishedPointLog = &finishedPointLog;
+		}
+		else
+		{
+			printf("Couldn't open history log %s, old timings will be dropped\n", options.historyLogPath.c_str());
+		}
+	}
 
 	auto startTime = std::chrono::high_resolution_clock::now();
 	auto currentTime = std::chrono::high_resolution_clock::now();
+	auto runStartTime = startTime;
 	int numFrames = 0;
+	int totalFrames = 0;
+	AllocationCounts previousAllocations = GetAllocationCounts();
 
-	while (1)
+	//snapshots only need to keep up with the display
+	auto snapshotInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / DISPLAY_RATE));
+	auto lastSnapshotTime = std::chrono::steady_clock::now() - snapshotInterval;
+
+	//capture frames until the source runs dry
+	while (!controls.quit && frameSource.Grab(frame))
 	{
-		RECT windowRectangle;
-		GetWindowRect(referenceWindowHandle, &windowRectangle);
+		//read the switches once so the whole frame sees the same settings
+		bool trackingEnabled = controls.trackingEnabled;
+		bool spinTrack = controls.spinTrack;
+		bool debugMode = controls.debugMode;
+		bool greenDebug = controls.greenDebug;
+		int greenMaskRadius = controls.greenMaskRadius;
+
+		if (controls.resetRequested.exchange(false))
+		{
+			spinTracker.Reset();
+			ballSearch.Reset();
+			greenSearch.Reset();
+			rotorPhase.Reset();
+			empiricalPredictor.Reset();
+			empiricalPocketCount = 0;
+		}
+		else if (!trackingEnabled)
+		{
+			//nothing is being followed, so the windows start from the whole frame again when tracking resumes
+			ballSearch.Reset();
+			greenSearch.Reset();
+		}
+
+		auto snapshotTime = std::chrono::steady_clock::now();
+		TrackerSnapshot* snapshot = nullptr;
+		if (snapshots != nullptr && snapshotTime - lastSnapshotTime >= snapshotInterval)
+		{
+			snapshot = &snapshots->GetWriteSlot();
+			snapshot->debugImages = debugMode;
+			snapshot->greenDebugImages = greenDebug;
+		}
+
+		currentFrame = frame.image;
 
-		referenceWindowLeft = windowRectangle.left + 9;
-		referenceWindowTop = windowRectangle.top + 32;
-		referenceWindowWidth = windowRectangle.right - windowRectangle.left - 9 - 8;
-		referenceWindowHeight = windowRectangle.bottom - windowRectangle.top - 32 - 8;
+		int frameWidth = currentFrame.cols;
+		int frameHeight = currentFrame.rows;
 
-		if (wheelCenter == Point(-1, -1))
+		if (spinTracker.wheelCenter == Point(-1, -1))
 		{
-			wheelCenter = Point(referenceWindowWidth / 2, referenceWindowHeight / 2);
+			spinTracker.wheelCenter = Point(frameWidth / 2, frameHeight / 2);
 		}
+		spinTracker.captureSize = currentFrame.size();
 
-		//capture frame
-		currentFrame = hwnd2mat(hwndDesktop);
+		cv::Point maskCenter(frameWidth / 2, frameHeight / 2);
+		const cv::Scalar greenLowerBound(45, 51, 51);
+		const cv::Scalar greenUpperBound(90, 255, 204);
 
-		//convert frame1 to gray scale for frame differencing
-		cv::cvtColor(currentFrame, currentGrayImage, COLOR_BGR2GRAY);
-		cv::circle(currentGrayImage, cv::Point(referenceWindowWidth / 2, referenceWindowHeight / 2), greenMaskRadius, cv::Scalar(0, 255, 0), -1);
+		//The ball is only looked for on the track outside the centre mask and the 0 only on the rotor ring
+		ballTrack.Prepare(currentFrame.size(), maskCenter, greenMaskRadius, options.ballTrackRadius);
+		rotorRing.Prepare(currentFrame.size(), maskCenter, options.rotorRingInnerRadius, options.rotorRingOuterRadius);
 
-		//filter frame for green
-		cv::cvtColor(currentFrame, currentGreenImage, COLOR_BGR2HSV);
-		cv::inRange(currentGreenImage, cv::Scalar(45, 51, 51), cv::Scalar(90, 255, 204), currentGreenImage);
+		//Strips of rings without an outer edge go out as far as the capture reaches all the way round
+		int edgeRadius = std::min(maskCenter.x, maskCenter.y);
+		int ballOuterRadius = options.ballTrackRadius > 0 ? options.ballTrackRadius : edgeRadius;
+		int greenInnerRadius = std::max(options.rotorRingInnerRadius, 0);
+		int greenOuterRadius = options.rotorRingOuterRadius > 0 ? options.rotorRingOuterRadius : edgeRadius;
+
+		//The strips replace the searches over the frame, except while the debug views want whole images
+		bool polarFrame = options.polarStrips && !debugMode && !greenDebug;
+		bool previousFrameValid = !previousFrame.image.empty() && previousFrame.image.size() == currentFrame.size();
 
-		if (greenDebug == true)
+		//The rotor ring unwrapped once for both the rotor phase and the search for the 0
+		bool greenStripRebuilt = false;
+		if (options.rotorPhase || polarFrame)
 		{
-			cv::imshow("Green Image", currentGreenImage);
+			greenStripRebuilt = greenStrip.Prepare(maskCenter, greenInnerRadius, std::max(greenOuterRadius, greenInnerRadius + 1));
+			greenStrip.Unwrap(currentFrame, greenStripImage);
+		}
+
+		//How far the rotor has turned since the last frame, from its unwrapped ring
+		if (options.rotorPhase)
+		{
+			if (greenStripRebuilt)
+			{
+				rotorPhase.Reset();
+			}
+			rotorPhase.Update(greenStripImage, frame.time);
+		}
+
+		if (polarFrame)
+		{
+			bool ballStripRebuilt = ballStrip.Prepare(maskCenter, greenMaskRadius, std::max(ballOuterRadius, greenMaskRadius + 1));
+			if (previousStripsStale || ballStripRebuilt || greenStripRebuilt)
+			{
+				if (previousFrameValid)
+				{
+					ballStrip.Unwrap(previousFrame.image, ballStripImage);
+					stripMotionMask.ComputeLuma(ballStripImage, previousBallStripLuma, ballStrip.GetSpans(), Point(0, 0));
+					//its own buffer, greenStripImage already holds this frame's strip
+					greenStrip.Unwrap(previousFrame.image, previousGreenStripImage);
+					greenRangeMask.Apply(previousGreenStripImage, previousGreenStripMask, greenLowerBound, greenUpperBound);
+				}
+				else
+				{
+					previousBallStripLuma.release();
+					previousGreenStripMask.release();
+				}
+				previousStripsStale = false;
+			}
 		}
 		else
 		{
-			cv::destroyWindow("Green Image");
+			previousStripsStale = true;
 		}
 
-		//If there is a previous image to compare to, do the rest
-		bool grayImageValid = !previousGrayImage.empty() && previousGrayImage.cols == currentGrayImage.cols && previousGrayImage.rows == currentGrayImage.rows;
-		bool greenImageValid = !previousGreenImage.empty() && previousGreenImage.cols == currentGreenImage.cols && previousGreenImage.rows == currentGreenImage.rows;
-		if (grayImageValid && greenImageValid)
+		//Once the ball or the 0 has been followed for a few frames only a window around its predicted position is searched.
+		//The debug views need whole images and the step by step gray path has no window version, so they always get the full frame.
+		cv::Rect ballWindow;
+		cv::Rect greenWindow;
+		if (options.predictiveSearch && previousFrameValid && trackingEnabled && useFusedGray && !debugMode && !greenDebug && !polarFrame)
+		{
+			ballWindow = ballSearch.GetWindow(frame.time, spinTracker.wheelCenter, currentFrame.size());
+			greenWindow = greenSearch.GetWindow(frame.time, spinTracker.wheelCenter, currentFrame.size());
+		}
+
+		//Get threshold image of the whole frame
+		bool grayImageValid;
+		Mat windowThresholdImage;
+		if (polarFrame)
+		{
+			//Just the unwrapped ball track, against the previous one
+			ballStrip.Unwrap(currentFrame, ballStripImage);
+			grayImageValid = stripMotionMask.Apply(ballStripImage, previousBallStripLuma, ballStripMask, ballStrip.GetSpans(), Point(0, 0), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+			previousGrayStale = true;
+		}
+		else if (ballWindow.area() > 0)
+		{
+			//Just the window, against the same part of the previous frame
+			Mat windowPreviousLuma = GetScratchArea(windowPreviousLumaBuffer, ballWindow.size(), CV_8UC1);
+			windowThresholdImage = GetScratchArea(windowThresholdBuffer, ballWindow.size(), CV_8UC1);
+
+			fusedMotionMask.ComputeLuma(previousFrame.image(ballWindow), windowPreviousLuma, ballTrack, ballWindow.tl());
+			grayImageValid = fusedMotionMask.Apply(currentFrame(ballWindow), windowPreviousLuma, windowThresholdImage, ballTrack, ballWindow.tl(), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+			previousGrayStale = true;
+		}
+		else if (useFusedGray && !debugMode)
 		{
-			//Get threshold image of the whole frame
+			if (previousGrayStale)
+			{
+				fusedMotionMask.ComputeLuma(previousFrame.image, previousGrayImage, ballTrack, Point(0, 0));
+				previousGrayStale = false;
+			}
+
+			//one pass from the captured frame to the cleaned up threshold image, previousGrayImage is updated to this frame as it goes
+			grayImageValid = fusedMotionMask.Apply(currentFrame, previousGrayImage, thresholdImage, ballTrack, Point(0, 0), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+		}
+		else
+		{
+			//The step by step version, which keeps the intermediate images around for the debug windows
+			if (previousGrayStale)
+			{
+				cv::cvtColor(previousFrame.image, previousGrayImage, COLOR_BGR2GRAY);
+				cv::bitwise_and(previousGrayImage, ballTrack.GetMask(), previousGrayImage);
+				previousGrayStale = false;
+			}
+
+			//convert frame1 to gray scale for frame differencing
+			cv::cvtColor(currentFrame, currentGrayImage, COLOR_BGR2GRAY);
+			//blank out everything off the ball track
+			cv::bitwise_and(currentGrayImage, ballTrack.GetMask(), currentGrayImage);
+
+			//If there is a previous image to compare to, do the rest
+			grayImageValid = !previousGrayImage.empty() && previousGrayImage.cols == currentGrayImage.cols && previousGrayImage.rows == currentGrayImage.rows;
+			if (grayImageValid)
 			{
 				//perform frame differencing with the sequential images. This will output an "intensity image"
 				//do not confuse this with a threshold image, we will need to perform thresholding afterwards.
 				cv::absdiff(currentGrayImage, previousGrayImage, differenceImage);
 				//threshold intensity image at a given sensitivity value
 				cv::threshold(differenceImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
-				if (debugMode == true)
+				if (snapshot != nullptr && debugMode == true)
 				{
-					//show the difference image and threshold image
-					cv::imshow("Difference Image", differenceImage);
-					cv::imshow("Threshold Image", thresholdImage);
-				}
-				else
-				{
-					//if not in debug mode, destroy the windows so we don't see them anymore
-					cv::destroyWindow("Difference Image");
-					cv::destroyWindow("Threshold Image");
+					//keep the difference image and threshold image for display
+					differenceImage.copyTo(snapshot->differenceImage);
+					thresholdImage.copyTo(snapshot->thresholdImage);
 				}
 
-				//blur the image to get rid of the noise. This will output an intensity image
-				cv::blur(thresholdImage, thresholdImage, cv::Size(BLUR_SIZE, BLUR_SIZE));
-				//threshold again to obtain binary image from blur output
-				cv::threshold(thresholdImage, thresholdImage, SENSITIVITY_VALUE, 255, THRESH_BINARY);
-				if (debugMode == true)
+				//blur the image to get rid of the noise and threshold again to obtain binary image from blur output
+				grayBoxThreshold.Apply(thresholdImage, thresholdImage, BLUR_SIZE, SENSITIVITY_VALUE);
+				if (snapshot != nullptr && debugMode == true)
 				{
-					//show the threshold image after it's been "blurred"
-					cv::imshow("Final Threshold Image", thresholdImage);
+					//keep the threshold image after it's been "blurred"
+					thresholdImage.copyTo(snapshot->finalThresholdImage);
 				}
-				else
+			}
+
+			if (options.verifyFused)
+			{
+				//The fused kernel keeps its own previous luma, so it sees exactly the frames this version sees
+				bool fusedValid = fusedMotionMask.Apply(currentFrame, verifyPreviousLuma, verifyThresholdImage, ballTrack, Point(0, 0), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+				bool lumaMatches = cv::norm(verifyPreviousLuma, currentGrayImage, NORM_INF) == 0;
+				bool maskMatches = !grayImageValid || cv::norm(verifyThresholdImage, thresholdImage, NORM_INF) == 0;
+				if (fusedValid != grayImageValid || !lumaMatches || !maskMatches)
 				{
-					//if not in debug mode, destroy the windows so we don't see them anymore
-					cv::destroyWindow("Final Threshold Image");
+					printf("Fused kernel differs on frame %d\n", frame.index);
+					mismatchedFrames++;
 				}
 			}
 
+			//the current image becomes the previous one, and the old previous buffer gets reused next frame
+			cv::swap(previousGrayImage, currentGrayImage);
+		}
+
+		//filter frame for green
+		bool greenImageValid;
+		Mat windowThresholdImageGreen;
+		if (polarFrame)
+		{
+			greenRangeMask.Apply(greenStripImage, greenStripMask, greenLowerBound, greenUpperBound);
+			previousGreenStale = true;
+			greenImageValid = previousGreenStripMask.size() == greenStripMask.size() && !previousGreenStripMask.empty();
+		}
+		else if (greenWindow.area() > 0)
+		{
+			Mat windowPreviousGreen = GetScratchArea(windowPreviousGreenBuffer, greenWindow.size(), CV_8UC1);
+			Mat windowGreen = GetScratchArea(windowGreenBuffer, greenWindow.size(), CV_8UC1);
+			Mat windowDifferenceGreen = GetScratchArea(windowDifferenceGreenBuffer, greenWindow.size(), CV_8UC1);
+			windowThresholdImageGreen = GetScratchArea(windowThresholdGreenBuffer, greenWindow.size(), CV_8UC1);
+
+			greenRangeMask.Apply(previousFrame.image(greenWindow), windowPreviousGreen, greenLowerBound, greenUpperBound, rotorRing, greenWindow.tl());
+			greenRangeMask.Apply(currentFrame(greenWindow), windowGreen, greenLowerBound, greenUpperBound, rotorRing, greenWindow.tl());
+			previousGreenStale = true;
+			greenImageValid = true;
+
+			//Get threshold image of just the green stuff in the window
+			cv::absdiff(windowGreen, windowPreviousGreen, windowDifferenceGreen);
+			cv::threshold(windowDifferenceGreen, windowThresholdImageGreen, SENSITIVITY_VALUE_GREEN, 255, THRESH_BINARY);
+			greenBoxThreshold.Apply(windowThresholdImageGreen, windowThresholdImageGreen, BLUR_SIZE, SENSITIVITY_VALUE_GREEN);
+		}
+		else
+		{
+			if (previousGreenStale)
+			{
+				greenRangeMask.Apply(previousFrame.image, previousGreenImage, greenLowerBound, greenUpperBound, rotorRing, Point(0, 0));
+				previousGreenStale = false;
+			}
+
+			greenRangeMask.Apply(currentFrame, currentGreenImage, greenLowerBound, greenUpperBound, rotorRing, Point(0, 0));
+
+			if (snapshot != nullptr && greenDebug == true)
+			{
+				currentGreenImage.copyTo(snapshot->greenImage);
+			}
+
+			greenImageValid = !previousGreenImage.empty() && previousGreenImage.cols == currentGreenImage.cols && previousGreenImage.rows == currentGreenImage.rows;
+		}
+
+		if (grayImageValid && greenImageValid)
+		{
 			//Get threshold image of just the green stuff
+			if (polarFrame)
+			{
+				cv::absdiff(greenStripMask, previousGreenStripMask, greenStripDifference);
+				cv::threshold(greenStripDifference, greenStripThreshold, SENSITIVITY_VALUE_GREEN, 255, THRESH_BINARY);
+				greenStripBoxThreshold.Apply(greenStripThreshold, greenStripThreshold, BLUR_SIZE, SENSITIVITY_VALUE_GREEN);
+			}
+			else if (greenWindow.area() == 0)
 			{
 				cv::absdiff(currentGreenImage, previousGreenImage, differenceImageGreen);
 
 				cv::threshold(differenceImageGreen, thresholdImageGreen, SENSITIVITY_VALUE_GREEN, 255, THRESH_BINARY);
-				if (greenDebug == true)
+				if (snapshot != nullptr && greenDebug == true)
 				{
-					cv::imshow("Difference Image Green", differenceImageGreen);
-				}
-				else
-				{
-					cv::destroyWindow("Difference Image Green");
+					differenceImageGreen.copyTo(snapshot->differenceImageGreen);
 				}
 
-				cv::blur(thresholdImageGreen, thresholdImageGreen, cv::Size(BLUR_SIZE, BLUR_SIZE));
+				greenBoxThreshold.Apply(thresholdImageGreen, thresholdImageGreen, BLUR_SIZE, SENSITIVITY_VALUE_GREEN);
 
-				cv::threshold(thresholdImageGreen, thresholdImageGreen, SENSITIVITY_VALUE_GREEN, 255, THRESH_BINARY);
-
-				if (greenDebug == true)
-				{
-					cv::imshow("Final Threshold Image Green", thresholdImageGreen);
-				}
-				else
+				if (snapshot != nullptr && greenDebug == true)
 				{
-					cv::destroyWindow("Final Threshold Image Green");
+					thresholdImageGreen.copyTo(snapshot->finalThresholdImageGreen);
 				}
 			}
 
 			//if tracking enabled, search for contours in our thresholded image
-			if (trackingEnabled)
+			if (trackingEnabled && polarFrame)
 			{
-				searchForMovement(thresholdImage, currentFrame, ballCenter);
-				searchForMovement(thresholdImageGreen, currentFrame, greenCenter);
+				searchForPeak(ballStripMask, ballCenter, ballStrip);
+				searchForPeak(greenStripThreshold, greenCenter, greenStrip);
 			}
-
-			//If tracking the spin, write the positions
-			if(spinTrack)
+			else if (trackingEnabled)
 			{
-				//Track the green 0
-				if(greenCenter.x != -1 && greenCenter.y != -1)
+				if (ballWindow.area() == 0)
 				{
-					//If we don't already have a reset point
-					if (resetPointGreen == cv::Point(-1, -1))
-					{
-						resetPointGreen = greenCenter;
-					}
-					else
-					{
-						if (innerWheelPoints.size() > 0)
-						{
-							greenPointPrevious = innerWheelPoints.back().point;
-						}
-
-						if (IsPointBetweenTwoPoints(wheelCenter, resetPointGreen, greenCenter, greenPointPrevious))
-						{
-							innerWheelPointsPrevious = std::vector<RouPoint>(innerWheelPoints);
-							innerWheelPoints.clear();
-							//printf("RESET\n");
-						}
-
-						RouPoint point(greenCenter);
-						point.time = std::chrono::high_resolution_clock::now();
-						innerWheelPoints.push_back(point);
-
-						int timeAround = GetTimeAround(wheelCenter, resetPointGreen, point, innerWheelPointsPrevious);
-						if (timeAround > 0)
-						{
-							cv::Point2f currentPointPolar = ToPolar(wheelCenter, greenCenter);
-							wheelSpeeds.push_back(FinishedPoint(currentPointPolar.x, currentPointPolar.y, timeAround, point.time));
-							//printf("Green time around: %d\n", timeAround);
-							printf("%d,", timeAround);
-						}
-					}
-
-					int avgX = 0;
-					int avgY = 0;
-					for (RouPoint p : innerWheelPointsPrevious)
-					{
-						avgX += p.point.x;
-						avgY += p.point.y;
-					}
-
-					if (innerWheelPointsPrevious.size() != 0)
-					{
-						cv::Point newCenter = cv::Point(avgX / (int)innerWheelPointsPrevious.size(), avgY / (int)innerWheelPointsPrevious.size());
-						wheelCenter = (wheelCenter + newCenter) / 2;
-					}
+					searchForMovement(thresholdImage, ballCenter, blobFinder);
 				}
-
-				//Track the ball
-				if(ballCenter.x != -1 && ballCenter.y != -1)
+				else
 				{
-					//If we don't already have a reset point
-					if (resetPointBall == cv::Point(-1, -1))
-					{
-						resetPointBall = ballCenter;
-					}
-					else
+					searchForMovement(windowThresholdImage, ballCenter, blobFinder);
+					if (ballCenter != Point(-1, -1))
 					{
-						if (ballPoints.size() > 0)
-						{
-							ballPointPrevious = ballPoints.back().point;
-						}
-
-						if (IsPointBetweenTwoPoints(wheelCenter, resetPointBall, ballCenter, ballPointPrevious))
-						{
-							ballPointsPrevious = std::vector<RouPoint>(ballPoints);
-							ballPoints.clear();
-							//printf("Ball RESET\n");
-						}
-
-						RouPoint point(ballCenter);
-						point.time = std::chrono::high_resolution_clock::now();
-						ballPoints.push_back(point);
-
-						int timeAround = GetTimeAround(wheelCenter, resetPointBall, point, ballPointsPrevious);
-
-						if (timeAround > 0)
-						{
-							cv::Point2f currentPointPolar = ToPolar(wheelCenter, ballCenter);
-							ballSpeeds.push_back(FinishedPoint(currentPointPolar.x, currentPointPolar.y, timeAround, point.time));
-							//printf("Ball time around: %d\n", timeAround);
-							//printf("%d,", timeAround);
-						}
-
-						if (GetEstimatedRadiusDifference(wheelCenter, resetPointBall, ballCenter, ballPointsPrevious) > 5.f)
-						{
-							ballPointsRadiusDecay.push_back(point);
-						}
+						ballCenter += ballWindow.tl();
 					}
 				}
 
-				cv::circle(currentFrame, wheelCenter, 5, Scalar(0, 0, 255), -1);
-				cv::line(currentFrame, wheelCenter, resetPointGreen, Scalar(255, 0, 0), 2);
-				cv::line(currentFrame, wheelCenter, resetPointBall, Scalar(0, 255, 255), 2);
-
-				for (RouPoint p : innerWheelPointsPrevious)
-				{
-					cv::circle(currentFrame, p.point, 2, Scalar(255, 255, 0), -1);
-				}
-				for (RouPoint p : innerWheelPoints)
-				{
-					cv::circle(currentFrame, p.point, 2, Scalar(255, 0, 0), -1);
-				}
-				for (RouPoint p : ballPointsPrevious)
+				if (greenWindow.area() == 0)
 				{
-					cv::circle(currentFrame, p.point, 2, Scalar(255, 255, 0), -1);
+					searchForMovement(thresholdImageGreen, greenCenter, blobFinder);
 				}
-				for (RouPoint p : ballPoints)
+				else
 				{
-					cv::circle(currentFrame, p.point, 2, Scalar(255, 0, 0), -1);
+					searchForMovement(windowThresholdImageGreen, greenCenter, blobFinder);
+					if (greenCenter != Point(-1, -1))
+					{
+						greenCenter += greenWindow.tl();
+					}
 				}
-				for (RouPoint p : ballPointsRadiusDecay)
+
+				if (options.predictiveSearch)
 				{
-					cv::circle(currentFrame, p.point, 2, Scalar(0, 0, 255), -1);
+					ballSearch.Update(ballCenter, frame.time, spinTracker.wheelCenter);
+					greenSearch.Update(greenCenter, frame.time, spinTracker.wheelCenter);
 				}
 			}
 
-			//Overlay the mask we use for the grayscale images for reference
-			Mat overlayFrame;
-			overlayFrame = currentFrame.clone();
-			cv::circle(overlayFrame, cv::Point(referenceWindowWidth / 2, referenceWindowHeight / 2), greenMaskRadius, cv::Scalar(0, 255, 0), -1);
-			double alpha = 0.5;
-
-			cv::addWeighted(overlayFrame, alpha, currentFrame, 1.0 - alpha, 0.0, currentFrame);
-
-			//show our captured frame
-			cv::imshow("FinalFrame", currentFrame);
-			//check to see if a button has been pressed.
-			//this 10ms delay is necessary for proper operation of this program
-			//if removed, frames will not have enough time to referesh and a blank 
-			//image will appear.
-			switch (waitKey(10))
+			//If tracking the spin, write the positions
+			if (spinTrack)
 			{
-			case 27: //'esc' key has been pressed, exit program.
-				return 0;
-			case 116: //'t' has been pressed. this will toggle tracking
-				trackingEnabled = !trackingEnabled;
-				if (trackingEnabled == false)
-				{
-					cout << "Tracking disabled." << endl;
-				}
-				else
-				{
-					cout << "Tracking enabled.\n" << endl;
-				}
-				break;
-			case 100: //'d' has been pressed. this will toggle debug mode
-				debugMode = !debugMode;
-				if (debugMode == false)
-				{
-					cout << "Debug mode disabled." << endl;
-				}
-				else
+				spinTracker.Update(ballCenter, greenCenter, frame.time);
+
+				float rotorVelocity, rotorVelocityVariance;
+				bool rotorValid = GetRotorVelocity(spinTracker, rotorPhase, rotorVelocity, rotorVelocityVariance);
+				const TrackStore& zeroPoints = spinTracker.innerWheelPoints;
+				predictionValid = options.predict && !zeroPoints.IsEmpty() && rotorValid
+					&& pocketPredictor.Predict(frame.time, spinTracker.ballMotion, zeroPoints.angle.back(), zeroPoints.time.back(), rotorVelocity, prediction);
+
+				likelyPocketCount = 0;
+				if (predictionValid && options.landingSamples > 0
+					&& landingDistribution.Estimate(frame.time, spinTracker.ballMotion, zeroPoints.angle.back(), zeroPoints.time.back(), rotorVelocity, rotorVelocityVariance))
 				{
-					cout << "Debug mode enabled." << endl;
+					likelyPocketCount = landingDistribution.GetMostLikely(likelyPockets, TrackerSnapshot::LIKELY_POCKETS);
 				}
-				break;
-			case 103: //'g' has been pressed. this will toggle green debug mode
-				greenDebug = !greenDebug;
-				if (greenDebug == false)
+
+				if (empiricalPrediction && empiricalPredictor.Update(frame.time, spinTracker, rotorValid, rotorVelocity))
 				{
-					cout << "Green debug mode disabled." << endl;
+					empiricalPocketCount = empiricalPredictor.GetMostLikely(empiricalPockets, TrackerSnapshot::LIKELY_POCKETS);
+					printf("Past spins' pick from %d of %d spins:", empiricalPredictor.GetVoterCount(), spinIndex.GetSize());
+					for (int i = 0; i < empiricalPocketCount; i++)
+					{
+						printf(" %d (%.0f%%)", empiricalPockets[i].pocket, empiricalPockets[i].probability * 100);
+					}
+					printf("\n");
 				}
-				else
+				else if (!empiricalPredictor.HasPrediction())
 				{
-					cout << "Green debug mode enabled." << endl;
+					//A new spin has started, so the last one's pick no longer applies
+					empiricalPocketCount = 0;
 				}
-				break;
-			case 114: //'r' has been pressed. this will reset the tracking arrays
-				resetPointGreen = cv::Point(-1, -1);
-				resetPointBall = cv::Point(-1, -1);
-
-				innerWheelPointsPrevious.clear();
-				innerWheelPoints.clear();
-
-				ballPointsPrevious.clear();
-				ballPoints.clear();
-				ballPointsRadiusDecay.clear();
-
-				ballSpeeds.clear();
-				wheelSpeeds.clear();
-				break;
-			case 115: //'s' has been pressed. this will toggle writing to the spin tracker
-				spinTrack = !spinTrack;
-				if (spinTrack == false)
-				{
-					cout << "Spin tracking disabled." << endl;
-					resetPointGreen = cv::Point(-1, -1);
-					resetPointBall = cv::Point(-1, -1);
+			}
+			else
+			{
+				predictionValid = false;
+				likelyPocketCount = 0;
+			}
 
-					innerWheelPointsPrevious.clear();
-					innerWheelPoints.clear();
+			if (snapshot != nullptr)
+			{
+				currentFrame.copyTo(snapshot->frame);
+				snapshot->frameIndex = frame.index;
+				snapshot->time = frame.time;
+
+				snapshot->trackingEnabled = trackingEnabled;
+				snapshot->spinTrack = spinTrack;
+				snapshot->greenMaskRadius = greenMaskRadius;
+
+				snapshot->ballCenter = ballCenter;
+				snapshot->greenCenter = greenCenter;
+
+				snapshot->wheelCenter = spinTracker.wheelCenter;
+				snapshot->rotorVelocityValid = rotorPhase.HasVelocity();
+				snapshot->rotorAngularVelocity = rotorPhase.GetAngularVelocity();
+				snapshot->ballMotionValid = spinTracker.ballMotion.IsValid();
+				snapshot->ballAngularVelocity = (float)spinTracker.ballMotion.GetAngularVelocity();
+				snapshot->ballDeceleration = (float)spinTracker.ballMotion.GetDeceleration();
+				snapshot->predictionValid = predictionValid;
+				snapshot->prediction = prediction;
+				snapshot->likelyPocketCount = likelyPocketCount;
+				std::copy(likelyPockets, likelyPockets + likelyPocketCount, snapshot->likelyPockets);
+				snapshot->empiricalPocketCount = empiricalPocketCount;
+				std::copy(empiricalPockets, empiricalPockets + empiricalPocketCount, snapshot->empiricalPockets);
+				snapshot->resetPointGreen = spinTracker.resetPointGreen;
+				snapshot->resetPointBall = spinTracker.resetPointBall;
+
+				CopyPoints(spinTracker.innerWheelPointsPrevious, snapshot->innerWheelPointsPrevious);
+				CopyPoints(spinTracker.innerWheelPoints, snapshot->innerWheelPoints);
+				CopyPoints(spinTracker.ballPointsPrevious, snapshot->ballPointsPrevious);
+				CopyPoints(spinTracker.ballPoints, snapshot->ballPoints);
+				CopyPoints(spinTracker.ballPointsRadiusDecay, snapshot->ballPointsRadiusDecay);
+
+				snapshots->Publish();
+				lastSnapshotTime = snapshotTime;
+			}
+		}
 
-					ballPointsPrevious.clear();
-					ballPoints.clear();
-					ballPointsRadiusDecay.clear();
+		//the current image becomes the previous one, and the old previous buffer gets reused next frame
+		if (polarFrame)
+		{
+			cv::swap(previousGreenStripMask, greenStripMask);
+		}
+		else if (greenWindow.area() == 0)
+		{
+			cv::swap(previousGreenImage, currentGreenImage);
+		}
+
+		//Windows and strips are compared against the previous frame itself. Swapping hands the old previous frame's buffer back to the source to fill.
+		if (options.predictiveSearch || options.polarStrips)
+		{
+			std::swap(frame, previousFrame);
+		}
 
-					ballSpeeds.clear();
-					wheelSpeeds.clear();
+		numFrames++;
+		totalFrames++;
+		currentTime = std::chrono::high_resolution_clock::now();
+
+		if (currentTime - startTime >= std::chrono::seconds(1))
+		{
+			//std::printf("Frames in the last second: %d\n", numFrames);
+			if (options.countAllocations)
+			{
+				AllocationCounts allocations = GetAllocationCounts();
+				if (IsCountingHeapAllocations())
+				{
+					printf("Frames: %d, heap allocations: %lld, Mat allocations: %lld\n", numFrames, allocations.heap - previousAllocations.heap, allocations.mat - previousAllocations.mat);
 				}
 				else
 				{
-					cout << "Spin tracking enabled." << endl;
+					printf("Frames: %d, Mat allocations: %lld\n", numFrames, allocations.mat - previousAllocations.mat);
 				}
-				break;
-			case 109: //'m' has been pressed. This will increase the radius of the green mask circle
-				greenMaskRadius = greenMaskRadius < referenceWindowWidth / 2 ? greenMaskRadius + 1 : greenMaskRadius;
-				cout << "Green mask radius increased, it is now: " << greenMaskRadius << endl;
-				break;
-			case 110: //'n' has been pressed. This will decrease the radius of the green mask circle
-				greenMaskRadius = greenMaskRadius > 1 ? greenMaskRadius - 1 : greenMaskRadius;
-				cout << "Green mask radius decreased, it is now: " << greenMaskRadius << endl;
-				break;
-			case 112: //'p' has been pressed. this will pause/resume the code.
-				pause = !pause;
-				if (pause == true)
+				previousAllocations = allocations;
+			}
+			if (options.predict && predictionValid)
+			{
+				printf("Predicted pocket: %d, ball leaves the track in %.2fs and lands in %.2fs\n", prediction.pocket, prediction.secondsToLeave, prediction.secondsToLand);
+				if (likelyPocketCount > 0)
 				{
-					cout << "Code paused, press 'p' again to resume" << endl;
-					while (pause == true)
+					printf("Most likely pockets from %d trajectories:", landingDistribution.GetSamplesDrawn());
+					for (int i = 0; i < likelyPocketCount; i++)
 					{
-						//stay in this loop until 
-						switch (waitKey())
-						{
-							case 112:
-								//change pause back to false
-								pause = false;
-								cout << "Code Resumed" << endl;
-							break;
-						}
+						printf(" %d (%.0f%%)", likelyPockets[i].pocket, likelyPockets[i].probability * 100);
 					}
+					printf("\n");
 				}
 			}
+			startTime = currentTime;
+			numFrames = 0;
 		}
+	}
 
-		previousGrayImage = currentGrayImage.clone();
-		previousGreenImage = currentGreenImage.clone();
-		
-		numFrames++;
-		currentTime = std::chrono::high_resolution_clock::now();
+	//Summary for batch runs over recorded sessions
+	double runSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - runStartTime).count();
+	printf("\nProcessed %d frames in %.2fs (%.1f fps), %lld wheel and %lld ball timings\n", totalFrames, runSeconds, runSeconds > 0 ? totalFrames / runSeconds : 0.0, spinTracker.wheelSpeedCount, spinTracker.ballSpeedCount);
 
-		if (currentTime - startTime >= std::chrono::seconds(1))
+	spinTracker.FlushHistory();
+
+	if (options.verifyFused)
+	{
+		printf("Fused gray kernel %s: %d of %d frames differ\n", fusedMotionMask.IsExact() ? "using known luma weights" : "doesn't know this OpenCV's luma weights", mismatchedFrames, totalFrames);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return -1;
+	}
+
+	if (options.countAllocations)
+	{
+		InstallMatAllocationCounter();
+
+		if (!IsCountingHeapAllocations())
 		{
-			//std::printf("Frames in the last second: %d\n", numFrames);
-			startTime = currentTime;
-			numFrames = 0;
+			printf("Heap allocations aren't counted in this build, configure with -DCOUNT_ALLOCATIONS=ON to count them\n");
+		}
+	}
+
+	//Live frames are stamped with wall time as they are captured
+	SteadyClock captureClock;
+	std::unique_ptr<FrameSource> frameSource;
+
+	if (!options.replayPath.empty() && MappedFrameSource::IsRecording(options.replayPath))
+	{
+		MappedFrameSource* mappedSource = new MappedFrameSource(options.replayPath);
+		frameSource.reset(mappedSource);
+
+		if (!mappedSource->IsOpen())
+		{
+			printf("Couldn't map recording %s!", options.replayPath.c_str());
+			return -1;
 		}
+		mappedSource->Seek(options.replayFrom);
+	}
+	else if (!options.replayPath.empty())
+	{
+		ReplayFrameSource* replaySource = new ReplayFrameSource(options.replayPath, options.replayTimestampPath, options.replayFramesPerSecond);
+		frameSource.reset(replaySource);
+
+		if (!replaySource->IsOpen())
+		{
+			printf("Couldn't open replay source %s!", options.replayPath.c_str());
+			return -1;
+		}
+	}
+	else
+	{
+#ifdef _WIN32
+		if (options.headless)
+		{
+			//Without a reference window the capture area has to be given up front
+			if (options.captureRegion.area() <= 0)
+			{
+				printf("Headless live capture needs --region <left>,<top>,<width>,<height>\n");
+				return -1;
+			}
+
+			frameSource.reset(new DesktopFrameSource(options.captureRegion, captureClock));
+		}
+		else
+		{
+			namedWindow("ReferenceFrame", WINDOW_NORMAL);
+
+			HWND referenceWindowHandle = FindWindow(0, "ReferenceFrame");
+			if (referenceWindowHandle == nullptr)
+			{
+				printf("Couldn't find reference window handle!");
+				return -1;
+			}
+
+			//-Set window to be click-through.
+			LONG lExStyle = GetWindowLong(referenceWindowHandle, GWL_EXSTYLE);
+			lExStyle |=  WS_EX_LAYERED;
+			SetWindowLong(referenceWindowHandle, GWL_EXSTYLE, lExStyle);
+			SetLayeredWindowAttributes(referenceWindowHandle, RGB(255, 0, 0), 0, LWA_COLORKEY);
+
+			Mat transparentImage(1, 1, CV_8UC4);
+			transparentImage = cv::Scalar(0, 0, 255, 255);
+			cv::imshow("ReferenceFrame", transparentImage);
+
+			frameSource.reset(new DesktopFrameSource(referenceWindowHandle, captureClock));
+		}
+#else
+		printf("Live desktop capture is only available on Windows, use --replay <path>\n");
+		return -1;
+#endif
+	}
+
+	//Recorded as captured, so an asynchronous capture is recorded on the capture thread
+	RecordingFrameSource* recorder = nullptr;
+	if (!options.recordPath.empty())
+	{
+		recorder = new RecordingFrameSource(std::move(frameSource));
+		frameSource.reset(recorder);
+
+		if (!recorder->Open(options.recordPath))
+		{
+			printf("Couldn't create recording %s!", options.recordPath.c_str());
+			return -1;
+		}
+	}
+
+	//Live capture runs on its own thread so the capture cadence doesn't depend on how long processing takes.
+	//Replays stay synchronous so that every recorded frame gets processed.
+	if (frameSource->IsLive() && !options.syncCapture)
+	{
+		frameSource.reset(new AsyncFrameSource(std::move(frameSource)));
+	}
+
+	//No HighGUI calls at all, tracking starts straight away since there are no keys to turn it on
+	TrackerControls controls(options.headless, options.headless);
+
+	if (options.headless)
+	{
+		RunTracking(*frameSource, options, controls, nullptr);
+	}
+	else
+	{
+		//Tracking gets its own thread and hands snapshots to this one, which owns the windows,
+		//so drawing, keyboard handling and pausing never hold up capture or timing
+		TripleBuffer<TrackerSnapshot> snapshots;
+		std::atomic<bool> trackerFinished(false);
+
+		std::thread trackingThread([&]()
+		{
+			RunTracking(*frameSource, options, controls, &snapshots);
+			trackerFinished = true;
+		});
+
+		RunPresentation(snapshots, controls, trackerFinished);
+
+		controls.quit = true;
+#ifdef _WIN32
+		//A capture waiting for a minimised reference window ends once the window is gone
+		if (options.replayPath.empty())
+		{
+			cv::destroyWindow("ReferenceFrame");
+		}
+#endif
+		trackingThread.join();
+	}
+
+	if (recorder != nullptr)
+	{
+		recorder->Close();
+		printf("Recorded %lld frames to %s, %lld dropped%s\n", recorder->GetRecordedFrames(), options.recordPath.c_str(), recorder->GetDroppedFrames(),
+			recorder->HasFailed() ? ", stopped early because the file couldn't be written" : "");
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
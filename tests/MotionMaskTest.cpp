@@ -0,0 +1,396 @@
+//Bit for bit check of FusedMotionMask against the chain of OpenCV calls it replaces:
+//cvtColor(BGR2GRAY), masking with the ball track, absdiff, threshold, blur and threshold again.
+//Every luma and motion mask has to match exactly (NORM_INF == 0), on random frames and on the edge cases
+//most likely to expose rounding or border differences, and on recorded frames when given a recording or video.
+//Returns non-zero if anything differs, or SKIP_RETURN_CODE when this OpenCV can't be checked.
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "AnnulusSpans.h"
+#include "FrameSource.h"
+#include "MappedFrameSource.h"
+#include "MotionMask.h"
+
+//The values the tracker runs with
+const static int SENSITIVITY_VALUE = 40;
+const static int BLUR_SIZE = 10;
+
+//Set as the test's SKIP_RETURN_CODE, so ctest reports a skip rather than a pass when nothing could be checked
+const static int SKIP_RETURN_CODE = 77;
+
+static int failures = 0;
+static int checks = 0;
+
+//The tracker's step by step version. previousLuma holds the last frame's masked luma and is replaced by this frame's.
+static bool ReferenceMotionMask(const cv::Mat& frame, cv::Mat& previousLuma, cv::Mat& motionMask, const cv::Mat& trackMask, int sensitivity, int boxSize, int boxSensitivity)
+{
+	cv::Mat luma;
+	cv::cvtColor(frame, luma, cv::COLOR_BGR2GRAY);
+	cv::bitwise_and(luma, trackMask, luma);
+
+	bool valid = !previousLuma.empty() && previousLuma.size() == luma.size();
+	if (valid)
+	{
+		cv::Mat difference;
+		cv::absdiff(luma, previousLuma, difference);
+		cv::threshold(difference, motionMask, sensitivity, 255, cv::THRESH_BINARY);
+		cv::blur(motionMask, motionMask, cv::Size(boxSize, boxSize));
+		cv::threshold(motionMask, motionMask, boxSensitivity, 255, cv::THRESH_BINARY);
+	}
+
+	previousLuma = luma;
+	return valid;
+}
+
+static void Check(bool passed, const char* name, int frame, const char* what)
+{
+	checks++;
+	if (!passed)
+	{
+		printf("FAIL %s, frame %d: %s\n", name, frame, what);
+		failures++;
+	}
+}
+
+//Runs a sequence of frames through both versions, within window of the track's image, and compares every result.
+//tracks holds the track for each frame, so the track can change part way through.
+static void CheckSequence(const char* name, const std::vector<cv::Mat>& frames, const std::vector<const AnnulusSpans*>& tracks, cv::Rect window,
+	int sensitivity = SENSITIVITY_VALUE, int boxSize = BLUR_SIZE, int boxSensitivity = SENSITIVITY_VALUE)
+{
+	FusedMotionMask fused;
+	cv::Mat fusedLuma;
+	cv::Mat fusedMask;
+	cv::Mat referenceLuma;
+	cv::Mat referenceMask;
+
+	for (int i = 0; i < (int)frames.size(); i++)
+	{
+		const AnnulusSpans& track = *tracks[i];
+		cv::Mat frame = frames[i](window);
+
+		bool referenceValid = ReferenceMotionMask(frame, referenceLuma, referenceMask, track.GetMask()(window), sensitivity, boxSize, boxSensitivity);
+		bool fusedValid = fused.Apply(frame, fusedLuma, fusedMask, track, window.tl(), sensitivity, boxSize, boxSensitivity);
+
+		Check(fusedValid == referenceValid, name, i, "valid differs");
+		Check(cv::norm(fusedLuma, referenceLuma, cv::NORM_INF) == 0, name, i, "luma differs");
+		if (fusedValid && referenceValid)
+		{
+			Check(cv::norm(fusedMask, referenceMask, cv::NORM_INF) == 0, name, i, "motion mask differs");
+		}
+	}
+
+	//ComputeLuma on its own, as used to restart from a frame that wasn't processed
+	cv::Mat luma;
+	fused.ComputeLuma(frames.back()(window), luma, *tracks.back(), window.tl());
+	Check(cv::norm(luma, referenceLuma, cv::NORM_INF) == 0, name, (int)frames.size() - 1, "ComputeLuma differs");
+}
+
+static void CheckSequence(const char* name, const std::vector<cv::Mat>& frames, const AnnulusSpans& track,
+	int sensitivity = SENSITIVITY_VALUE, int boxSize = BLUR_SIZE, int boxSensitivity = SENSITIVITY_VALUE)
+{
+	std::vector<const AnnulusSpans*> tracks(frames.size(), &track);
+	CheckSequence(name, frames, tracks, cv::Rect(cv::Point(0, 0), track.GetSize()), sensitivity, boxSize, boxSensitivity);
+}
+
+//Every frame of a raw recording (--record) or a video, in order, the way the tracker sees them: the whole image,
+//a ring around the centre like the ball track, and a search window on that ring
+static bool CheckRecording(const std::string& path)
+{
+	std::unique_ptr<FrameSource> source;
+	if (MappedFrameSource::IsRecording(path))
+	{
+		std::unique_ptr<MappedFrameSource> recording(new MappedFrameSource(path));
+		if (recording->IsOpen())
+		{
+			source = std::move(recording);
+		}
+	}
+	else
+	{
+		std::unique_ptr<ReplayFrameSource> replay(new ReplayFrameSource(path, "", 60));
+		if (replay->IsOpen())
+		{
+			source = std::move(replay);
+		}
+	}
+	if (!source)
+	{
+		printf("FAIL: can't open %s\n", path.c_str());
+		failures++;
+		return false;
+	}
+
+	const int CONFIGURATIONS = 3;
+	FusedMotionMask fused[CONFIGURATIONS];
+	cv::Mat fusedLuma[CONFIGURATIONS];
+	cv::Mat fusedMask[CONFIGURATIONS];
+	cv::Mat referenceLuma[CONFIGURATIONS];
+	cv::Mat referenceMask[CONFIGURATIONS];
+	const char* names[CONFIGURATIONS] = { "recording whole image", "recording ring", "recording window" };
+
+	AnnulusSpans wholeImage;
+	AnnulusSpans ring;
+	Frame frame;
+	int frameCount = 0;
+	while (source->Grab(frame))
+	{
+		cv::Size size = frame.image.size();
+		cv::Point centre(size.width / 2, size.height / 2);
+		int radius = std::min(size.width, size.height) / 2;
+		wholeImage.Prepare(size, centre, -1, 0);
+		ring.Prepare(size, centre, radius / 2, radius * 9 / 10);
+
+		cv::Rect window = cv::Rect(centre.x + radius / 2, centre.y - radius / 4, radius / 2, radius / 2) & cv::Rect(cv::Point(0, 0), size);
+		if (window.area() == 0)
+		{
+			window = cv::Rect(cv::Point(0, 0), size);
+		}
+
+		const AnnulusSpans* tracks[CONFIGURATIONS] = { &wholeImage, &ring, &ring };
+		const cv::Rect windows[CONFIGURATIONS] = { cv::Rect(cv::Point(0, 0), size), cv::Rect(cv::Point(0, 0), size), window };
+		for (int i = 0; i < CONFIGURATIONS; i++)
+		{
+			cv::Mat image = frame.image(windows[i]);
+			bool referenceValid = ReferenceMotionMask(image, referenceLuma[i], referenceMask[i], tracks[i]->GetMask()(windows[i]), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+			bool fusedValid = fused[i].Apply(image, fusedLuma[i], fusedMask[i], *tracks[i], windows[i].tl(), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+
+			Check(fusedValid == referenceValid, names[i], frameCount, "valid differs");
+			Check(cv::norm(fusedLuma[i], referenceLuma[i], cv::NORM_INF) == 0, names[i], frameCount, "luma differs");
+			if (fusedValid && referenceValid)
+			{
+				Check(cv::norm(fusedMask[i], referenceMask[i], cv::NORM_INF) == 0, names[i], frameCount, "motion mask differs");
+			}
+		}
+		frameCount++;
+	}
+
+	printf("%d frames of %s checked\n", frameCount, path.c_str());
+	if (frameCount < 2)
+	{
+		printf("FAIL: %s needs at least two frames to compare\n", path.c_str());
+		failures++;
+		return false;
+	}
+	return true;
+}
+
+static cv::Mat RandomFrame(cv::RNG& rng, cv::Size size)
+{
+	cv::Mat frame(size, CV_8UC4);
+	rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+	return frame;
+}
+
+//Random noise where only a few blobs move, so the box stage sees both sparse and dense motion
+static std::vector<cv::Mat> MovingBlobs(cv::RNG& rng, cv::Size size, int count)
+{
+	std::vector<cv::Mat> frames;
+	cv::Mat background = RandomFrame(rng, size);
+	for (int i = 0; i < count; i++)
+	{
+		cv::Mat frame = background.clone();
+		for (int blob = 0; blob < 5; blob++)
+		{
+			cv::Point centre(rng.uniform(0, size.width), rng.uniform(0, size.height));
+			cv::circle(frame, centre, rng.uniform(1, 12), cv::Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256), 255), -1);
+		}
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+//With a path, checks that recording or video as well as the built in frames
+int main(int argc, char** argv)
+{
+	cv::RNG rng(0x5eed);
+
+	//The fused kernel only promises exact results when it knows how this OpenCV rounds the luma
+	FusedMotionMask calibration;
+	if (!calibration.IsExact())
+	{
+		printf("SKIP: this OpenCV's BGR2GRAY rounding isn't known to the fused kernel, so the tracker doesn't use it\n");
+		return SKIP_RETURN_CODE;
+	}
+
+	if (argc > 1)
+	{
+		CheckRecording(argv[1]);
+	}
+
+	//Frame sizes that aren't multiples of the SIMD width, down to smaller than the blur box
+	const cv::Size sizes[] = { cv::Size(640, 480), cv::Size(333, 251), cv::Size(17, 9), cv::Size(7, 5), cv::Size(1, 1), cv::Size(16, 1), cv::Size(1, 16) };
+	for (const cv::Size& size : sizes)
+	{
+		cv::Point centre(size.width / 2, size.height / 2);
+		int radius = std::max(size.width, size.height) / 2;
+
+		//Whole image, a ring, and a ring cut off by the image edges
+		AnnulusSpans wholeImage;
+		wholeImage.Prepare(size, centre, -1, 0);
+		AnnulusSpans ring;
+		ring.Prepare(size, centre, radius / 3, radius * 4 / 5);
+		AnnulusSpans offCentre;
+		offCentre.Prepare(size, cv::Point(size.width / 5, size.height), radius / 4, radius * 3 / 2);
+
+		std::vector<cv::Mat> noise;
+		for (int i = 0; i < 4; i++)
+		{
+			noise.push_back(RandomFrame(rng, size));
+		}
+
+		char name[128];
+		snprintf(name, sizeof(name), "noise %dx%d whole image", size.width, size.height);
+		CheckSequence(name, noise, wholeImage);
+		snprintf(name, sizeof(name), "noise %dx%d ring", size.width, size.height);
+		CheckSequence(name, noise, ring);
+		snprintf(name, sizeof(name), "noise %dx%d off centre ring", size.width, size.height);
+		CheckSequence(name, noise, offCentre);
+
+		snprintf(name, sizeof(name), "blobs %dx%d ring", size.width, size.height);
+		CheckSequence(name, MovingBlobs(rng, size, 6), ring);
+
+		//Box sizes and sensitivities either side of the tracker's, including boxes that never reach the threshold
+		snprintf(name, sizeof(name), "noise %dx%d box 1", size.width, size.height);
+		CheckSequence(name, noise, ring, SENSITIVITY_VALUE, 1, SENSITIVITY_VALUE);
+		snprintf(name, sizeof(name), "noise %dx%d box 3 sensitivity 0", size.width, size.height);
+		CheckSequence(name, noise, ring, 0, 3, 0);
+		snprintf(name, sizeof(name), "noise %dx%d box 15 sensitivity 254", size.width, size.height);
+		CheckSequence(name, noise, wholeImage, 254, 15, 254);
+		snprintf(name, sizeof(name), "noise %dx%d box 4 sensitivity 128", size.width, size.height);
+		CheckSequence(name, noise, wholeImage, 128, 4, 128);
+	}
+
+	cv::Size size(320, 240);
+	cv::Point centre(160, 120);
+	AnnulusSpans track;
+	track.Prepare(size, centre, 40, 110);
+
+	//Flat frames: nothing moving, everything moving at full contrast, and saturated colours
+	{
+		std::vector<cv::Mat> frames;
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(0, 0, 0, 0)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(0, 0, 0, 0)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(255, 255, 255, 255)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(255, 255, 255, 0)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(255, 0, 0, 255)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(0, 255, 0, 255)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(0, 0, 255, 255)));
+		frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(0, 0, 0, 255)));
+		CheckSequence("flat frames", frames, track);
+	}
+
+	//Gray levels that differ by exactly the sensitivity and by one either side of it, since only a difference
+	//above the sensitivity counts
+	{
+		std::vector<cv::Mat> frames;
+		const int levels[] = { 100, 100 + SENSITIVITY_VALUE, 100 + SENSITIVITY_VALUE * 2 + 1, 100 + SENSITIVITY_VALUE + 2, 100 + 1 };
+		for (int level : levels)
+		{
+			frames.push_back(cv::Mat(size, CV_8UC4, cv::Scalar(level, level, level, 255)));
+		}
+		CheckSequence("differences around the sensitivity", frames, track);
+	}
+
+	//Checkerboards and stripes, where every box straddles set and unset pixels and the border reflection matters
+	{
+		std::vector<cv::Mat> frames;
+		for (int i = 0; i < 4; i++)
+		{
+			cv::Mat frame(size, CV_8UC4);
+			for (int y = 0; y < size.height; y++)
+			{
+				uchar* bgra = frame.ptr<uchar>(y);
+				for (int x = 0; x < size.width; x++, bgra += 4)
+				{
+					bool set = i == 0 ? ((x + y) & 1) != 0 : i == 1 ? ((x / 3 + y / 3) & 1) != 0 : i == 2 ? (x % 7) < 3 : (y % 5) < 2;
+					bgra[0] = bgra[1] = bgra[2] = set ? 255 : 0;
+					bgra[3] = 255;
+				}
+			}
+			frames.push_back(frame);
+		}
+		CheckSequence("patterns", frames, track);
+	}
+
+	//Sub-images with a row step larger than their width, and the search window path that works on part of the track
+	{
+		std::vector<cv::Mat> frames = MovingBlobs(rng, size, 6);
+		std::vector<const AnnulusSpans*> tracks(frames.size(), &track);
+		CheckSequence("window on the track", frames, tracks, cv::Rect(150, 20, 61, 45));
+		CheckSequence("window at the corner", frames, tracks, cv::Rect(0, 0, 33, 17));
+		CheckSequence("window at the far edge", frames, tracks, cv::Rect(size.width - 40, size.height - 30, 40, 30));
+	}
+
+	//The track moving and resizing part way through, where pixels that come onto the track compare against the
+	//old track's 0s in both versions. Like the tracker, one AnnulusSpans is prepared again for each change.
+	{
+		const cv::Point centres[] = { centre, centre, cv::Point(170, 110), cv::Point(170, 110), cv::Point(170, 110), centre };
+		const int innerRadii[] = { 40, 40, 30, 30, -1, 40 };
+		const int outerRadii[] = { 110, 110, 100, 100, 0, 110 };
+
+		std::vector<cv::Mat> frames = MovingBlobs(rng, size, 6);
+		AnnulusSpans changingTrack;
+
+		FusedMotionMask fused;
+		cv::Mat fusedLuma;
+		cv::Mat fusedMask;
+		cv::Mat referenceLuma;
+		cv::Mat referenceMask;
+
+		for (int i = 0; i < (int)frames.size(); i++)
+		{
+			changingTrack.Prepare(size, centres[i], innerRadii[i], outerRadii[i]);
+
+			bool referenceValid = ReferenceMotionMask(frames[i], referenceLuma, referenceMask, changingTrack.GetMask(), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+			bool fusedValid = fused.Apply(frames[i], fusedLuma, fusedMask, changingTrack, cv::Point(0, 0), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+
+			Check(fusedValid == referenceValid, "track changes", i, "valid differs");
+			Check(cv::norm(fusedLuma, referenceLuma, cv::NORM_INF) == 0, "track changes", i, "luma differs");
+			if (fusedValid && referenceValid)
+			{
+				Check(cv::norm(fusedMask, referenceMask, cv::NORM_INF) == 0, "track changes", i, "motion mask differs");
+			}
+		}
+	}
+
+	//Frame size changes restart the comparison
+	{
+		std::vector<cv::Mat> small = MovingBlobs(rng, cv::Size(100, 80), 3);
+		std::vector<cv::Mat> large = MovingBlobs(rng, size, 3);
+
+		FusedMotionMask fused;
+		cv::Mat fusedLuma;
+		cv::Mat fusedMask;
+		cv::Mat referenceLuma;
+		cv::Mat referenceMask;
+		AnnulusSpans smallTrack;
+		smallTrack.Prepare(small[0].size(), cv::Point(50, 40), 10, 35);
+
+		for (int i = 0; i < 6; i++)
+		{
+			bool useSmall = i < 2 || i == 4;
+			const cv::Mat& frame = useSmall ? small[i % 3] : large[i % 3];
+			const AnnulusSpans& frameTrack = useSmall ? smallTrack : track;
+
+			bool referenceValid = ReferenceMotionMask(frame, referenceLuma, referenceMask, frameTrack.GetMask(), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+			bool fusedValid = fused.Apply(frame, fusedLuma, fusedMask, frameTrack, cv::Point(0, 0), SENSITIVITY_VALUE, BLUR_SIZE, SENSITIVITY_VALUE);
+
+			Check(fusedValid == referenceValid, "size changes", i, "valid differs");
+			Check(cv::norm(fusedLuma, referenceLuma, cv::NORM_INF) == 0, "size changes", i, "luma differs");
+			if (fusedValid && referenceValid)
+			{
+				Check(cv::norm(fusedMask, referenceMask, cv::NORM_INF) == 0, "size changes", i, "motion mask differs");
+			}
+		}
+	}
+
+	printf("%d of %d checks failed\n", failures, checks);
+	return failures == 0 ? 0 : 1;
+}
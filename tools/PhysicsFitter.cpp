@@ -0,0 +1,123 @@
+//Fits the ball model's constants for one wheel to the timings the tracker logged with --history-log,
+//and writes them to a file the tracker reads with --wheel-file
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "BallTrajectory.h"
+#include "SpinHistory.h"
+#include "WheelFit.h"
+
+static void PrintUsage(const char* programName)
+{
+	printf("Usage: %s [options] --output <file> <history log>...\n", programName);
+	printf("  --output <file>              where to write the fitted constants (.yml or .xml)\n");
+	printf("  --wheel <rim>,<deflector>,<incline>,<friction>,<drag>\n");
+	printf("                               lengths to write out, and the constants to start the fit from\n");
+	printf("  --wheel-file <file>          start from the constants in an earlier file instead\n");
+	printf("  --threads <n>                threads to fit with (default: all cores)\n");
+	printf("  --help                       show this message\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::string outputPath;
+	std::vector<std::string> historyPaths;
+	WheelConstants constants;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--output") == 0 && hasValue)
+		{
+			outputPath = argv[++i];
+		}
+		else if (strcmp(arg, "--wheel") == 0 && hasValue)
+		{
+			if (sscanf(argv[++i], "%lf,%lf,%lf,%lf,%lf", &constants.rimRadius, &constants.deflectorRadius, &constants.statorIncline, &constants.rollingFriction, &constants.airDrag) != 5)
+			{
+				printf("Couldn't parse wheel: %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(arg, "--wheel-file") == 0 && hasValue)
+		{
+			if (!LoadWheelConstants(argv[++i], constants))
+			{
+				printf("Couldn't read wheel file: %s\n", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(arg, "--threads") == 0 && hasValue && atoi(argv[i + 1]) > 0)
+		{
+			cv::setNumThreads(atoi(argv[++i]));
+		}
+		else if (arg[0] != '-')
+		{
+			historyPaths.push_back(arg);
+		}
+		else
+		{
+			if (strcmp(arg, "--help") != 0)
+			{
+				printf("Unknown or incomplete option: %s\n", arg);
+			}
+			PrintUsage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (outputPath.empty() || historyPaths.empty())
+	{
+		PrintUsage(argv[0]);
+		return -1;
+	}
+
+	std::vector<RecordedSpin> spins;
+	for (const std::string& path : historyPaths)
+	{
+		if (!LoadSpinHistory(path, spins))
+		{
+			printf("Couldn't open history log %s\n", path.c_str());
+			return -1;
+		}
+	}
+
+	WheelFit fit(spins);
+	printf("Fitting %d laps from %d of %d spins\n", fit.GetLapCount(), fit.GetSpinCount(), (int)spins.size());
+	if (!fit.Fit(constants))
+	{
+		printf("None of the spins had enough ball timings in the rim to fit\n");
+		return -1;
+	}
+
+	printf("Rolling friction %.4f rad/s^2, air drag %.6f /rad, error %.2f degrees a lap\n", constants.rollingFriction, constants.airDrag, fit.GetRmsError());
+	if (fit.GetLeaveCount() > 0)
+	{
+		printf("Stator incline %.4f rad from where the ball left the rim in %d spins\n", constants.statorIncline, fit.GetLeaveCount());
+	}
+	else
+	{
+		printf("No spin showed the ball leaving the rim, keeping the stator incline of %.4f rad\n", constants.statorIncline);
+	}
+
+	if (!BallTrajectory(constants).IsValid())
+	{
+		printf("Warning: the tracker's ball model can't use these constants\n");
+	}
+
+	if (!SaveWheelConstants(outputPath, constants))
+	{
+		printf("Couldn't write %s\n", outputPath.c_str());
+		return -1;
+	}
+
+	return 0;
+}